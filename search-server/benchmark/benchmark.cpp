@@ -0,0 +1,632 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <set>
+#include <thread>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "workload.h"
+#include "../search_server.h"
+#include "../process_queries.h"
+#include "../remove_duplicates.h"
+#include "../near_duplicates.h"
+#include "../metrics.h"
+#include "../request_scheduler.h"
+
+using namespace std;
+
+// every scenario reports global heap allocations per operation, counted by the replaced operator new;
+// the default operator delete of libstdc++ releases memory with free, so it is left as is
+atomic<size_t> heap_allocations{0};
+
+void* operator new(size_t size) {
+    heap_allocations.fetch_add(1, memory_order_relaxed);
+    if (void* pointer = malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw bad_alloc();
+}
+
+struct BenchmarkConfig {
+    vector<size_t> document_counts = {10'000};
+    size_t vocabulary_size = 50'000;
+    double zipf_exponent = 1.0;
+    size_t query_count = 10'000;
+    int max_query_words = 8;
+    double minus_prob = 0.1;
+    int min_document_words = 10;
+    int max_document_words = 100;
+    double duplicate_rate = 0.01;
+    // used only for the corpus of the near_duplicates scenario
+    double near_duplicate_rate = 0.02;
+    double near_duplicate_threshold = 0.7;
+    size_t exact_jaccard_limit = 2'000;
+    size_t stop_word_count = 5;
+    size_t remove_count = 1'000;
+    uint64_t seed = 42;
+    int deadline_ms = 50;
+    set<string> scenarios;
+    string json_path;
+};
+
+struct ScenarioResult {
+    string scenario;
+    size_t documents = 0;
+    size_t items = 0;
+    double seconds = 0.0;
+    LatencySummary latency;
+    long peak_rss_kb = 0;
+    MetricsSnapshot stages;
+    map<string, double> extra;
+};
+
+const vector<string> ALL_SCENARIOS = {
+    "add_document"s, "find_top_seq"s, "find_top_par"s, "find_top_prepared"s, "find_top_all"s, "find_top_status"s, "search_after_pages"s, "find_top_async"s, "scheduler_overload"s,
+    "find_top_predicate"s, "find_top_rating_predicate"s, "find_top_rating_filter"s, "match_document"s,
+    "match_document_par"s, "match_documents_batch"s, "match_documents_batch_par"s, "process_queries"s,
+    "word_frequencies"s, "word_frequencies_batch"s, "near_duplicates"s, "remove_duplicates"s, "remove_document"s, "teardown"s,
+};
+
+vector<string> SplitList(const string& text) {
+    vector<string> items;
+    stringstream stream(text);
+    for (string item; getline(stream, item, ',');) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+BenchmarkConfig ParseArguments(int argc, char** argv) {
+    BenchmarkConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        const size_t equals = argument.find('=');
+        const string key = argument.substr(0, equals);
+        const string value = equals == string::npos ? ""s : argument.substr(equals + 1);
+        if (key == "--docs"s) {
+            config.document_counts.clear();
+            for (const string& count : SplitList(value)) {
+                config.document_counts.push_back(stoull(count));
+            }
+        } else if (key == "--vocab"s) {
+            config.vocabulary_size = stoull(value);
+        } else if (key == "--zipf"s) {
+            config.zipf_exponent = stod(value);
+        } else if (key == "--queries"s) {
+            config.query_count = stoull(value);
+        } else if (key == "--query-words"s) {
+            config.max_query_words = stoi(value);
+        } else if (key == "--minus-prob"s) {
+            config.minus_prob = stod(value);
+        } else if (key == "--min-words"s) {
+            config.min_document_words = stoi(value);
+        } else if (key == "--max-words"s) {
+            config.max_document_words = stoi(value);
+        } else if (key == "--dup-rate"s) {
+            config.duplicate_rate = stod(value);
+        } else if (key == "--near-dup-rate"s) {
+            config.near_duplicate_rate = stod(value);
+        } else if (key == "--near-dup-threshold"s) {
+            config.near_duplicate_threshold = stod(value);
+        } else if (key == "--exact-limit"s) {
+            config.exact_jaccard_limit = stoull(value);
+        } else if (key == "--stop-words"s) {
+            config.stop_word_count = stoull(value);
+        } else if (key == "--remove"s) {
+            config.remove_count = stoull(value);
+        } else if (key == "--seed"s) {
+            config.seed = stoull(value);
+        } else if (key == "--deadline-ms"s) {
+            config.deadline_ms = stoi(value);
+        } else if (key == "--scenarios"s) {
+            for (const string& scenario : SplitList(value)) {
+                config.scenarios.insert(scenario);
+            }
+        } else if (key == "--json"s) {
+            config.json_path = value;
+        } else {
+            throw invalid_argument("unknown argument "s + argument);
+        }
+    }
+    if (config.scenarios.empty()) {
+        config.scenarios.insert(ALL_SCENARIOS.begin(), ALL_SCENARIOS.end());
+    }
+    return config;
+}
+
+int64_t ToNanoseconds(chrono::steady_clock::duration duration) {
+    return chrono::duration_cast<chrono::nanoseconds>(duration).count();
+}
+
+// operation(i) is timed individually; items_per_operation scales throughput for batch operations
+template <typename Operation>
+ScenarioResult RunScenario(const string& name, size_t documents, size_t operations, Operation operation,
+                           size_t items_per_operation = 1) {
+    ResetMetrics();
+    vector<int64_t> latencies;
+    latencies.reserve(operations);
+    const size_t allocations_before = heap_allocations.load(memory_order_relaxed);
+    const auto start_time = chrono::steady_clock::now();
+    for (size_t i = 0; i < operations; ++i) {
+        const auto operation_start = chrono::steady_clock::now();
+        operation(i);
+        latencies.push_back(ToNanoseconds(chrono::steady_clock::now() - operation_start));
+    }
+    const size_t allocations = heap_allocations.load(memory_order_relaxed) - allocations_before;
+    ScenarioResult result;
+    result.scenario = name;
+    result.documents = documents;
+    result.items = operations * items_per_operation;
+    result.seconds = ToNanoseconds(chrono::steady_clock::now() - start_time) / 1e9;
+    result.latency = SummarizeLatencies(move(latencies));
+    result.peak_rss_kb = GetPeakRssKb();
+    result.stages = GetMetrics();
+    result.extra["allocs_per_op"s] = operations > 0 ? static_cast<double>(allocations) / operations : 0.0;
+    return result;
+}
+
+void PrintResult(ostream& out, const ScenarioResult& result) {
+    out << left << setw(20) << result.scenario << right
+        << " docs="s << setw(9) << result.documents
+        << " ops/s="s << setw(12) << fixed << setprecision(1) << (result.seconds > 0 ? result.items / result.seconds : 0.0)
+        << " p50="s << setw(10) << result.latency.p50_ns << "ns"s
+        << " p99="s << setw(10) << result.latency.p99_ns << "ns"s
+        << " p999="s << setw(10) << result.latency.p999_ns << "ns"s
+        << " peak_rss="s << result.peak_rss_kb << "KB"s;
+    for (const auto& [name, value] : result.extra) {
+        out << " "s << name << "="s << value;
+    }
+    out << endl;
+}
+
+void WriteJson(ostream& out, const BenchmarkConfig& config, const vector<ScenarioResult>& results) {
+    out << "{\n  \"config\": {"s
+        << "\"vocabulary_size\": "s << config.vocabulary_size
+        << ", \"zipf_exponent\": "s << config.zipf_exponent
+        << ", \"query_count\": "s << config.query_count
+        << ", \"max_query_words\": "s << config.max_query_words
+        << ", \"minus_prob\": "s << config.minus_prob
+        << ", \"min_document_words\": "s << config.min_document_words
+        << ", \"max_document_words\": "s << config.max_document_words
+        << ", \"duplicate_rate\": "s << config.duplicate_rate
+        << ", \"near_duplicate_rate\": "s << config.near_duplicate_rate
+        << ", \"near_duplicate_threshold\": "s << config.near_duplicate_threshold
+        << ", \"seed\": "s << config.seed << "},\n  \"results\": ["s;
+    bool first = true;
+    for (const ScenarioResult& result : results) {
+        out << (first ? "\n"s : ",\n"s);
+        first = false;
+        out << "    {\"scenario\": \""s << result.scenario << "\""s
+            << ", \"documents\": "s << result.documents
+            << ", \"items\": "s << result.items
+            << ", \"seconds\": "s << result.seconds
+            << ", \"throughput\": "s << (result.seconds > 0 ? result.items / result.seconds : 0.0)
+            << ", \"latency_ns\": {\"mean\": "s << result.latency.mean_ns
+            << ", \"p50\": "s << result.latency.p50_ns
+            << ", \"p90\": "s << result.latency.p90_ns
+            << ", \"p99\": "s << result.latency.p99_ns
+            << ", \"p999\": "s << result.latency.p999_ns
+            << ", \"max\": "s << result.latency.max_ns << "}"s
+            << ", \"peak_rss_kb\": "s << result.peak_rss_kb;
+        for (const auto& [name, value] : result.extra) {
+            out << ", \""s << name << "\": "s << value;
+        }
+        out << ", \"stages\": {"s;
+        bool first_stage = true;
+        for (size_t i = 0; i < SEARCH_STAGE_COUNT; ++i) {
+            const HistogramSnapshot& stage = result.stages.stages[i];
+            if (stage.count == 0) continue;
+            out << (first_stage ? ""s : ", "s) << "\""s << GetStageName(static_cast<SearchStage>(i)) << "\": {"s
+                << "\"count\": "s << stage.count << ", \"p50\": "s << stage.p50_ns << ", \"p99\": "s << stage.p99_ns << "}"s;
+            first_stage = false;
+        }
+        out << "}, \"planner\": {"s;
+        for (size_t i = 0; i < PLANNER_DECISION_COUNT; ++i) {
+            out << (i == 0 ? ""s : ", "s) << "\""s << GetPlannerDecisionName(static_cast<PlannerDecision>(i)) << "\": "s
+                << result.stages.planner_decisions[i];
+        }
+        out << "}}"s;
+    }
+    out << "\n  ]\n}\n"s;
+}
+
+// near_duplicate_rate is only given for the corpora of the near_duplicates scenario, so the other
+// scenarios run on the same corpus whatever that rate is
+CorpusConfig MakeCorpusConfig(const BenchmarkConfig& config, size_t document_count, double near_duplicate_rate = 0.0) {
+    CorpusConfig corpus_config;
+    corpus_config.document_count = document_count;
+    corpus_config.zipf_exponent = config.zipf_exponent;
+    corpus_config.min_words = config.min_document_words;
+    corpus_config.max_words = config.max_document_words;
+    corpus_config.duplicate_rate = config.duplicate_rate;
+    corpus_config.near_duplicate_rate = near_duplicate_rate;
+    return corpus_config;
+}
+
+// Exact all-pairs Jaccard is quadratic, so recall is measured on a prefix of the same corpus
+double MeasureNearDuplicateRecall(const BenchmarkConfig& config, size_t document_count,
+                                  const vector<string>& vocabulary, const vector<string>& stop_words) {
+    const size_t sample_count = min(document_count, config.exact_jaccard_limit);
+    SearchServer sample_server(stop_words);
+    CorpusGenerator corpus(vocabulary, MakeCorpusConfig(config, sample_count, config.near_duplicate_rate),
+                           config.seed + document_count);
+    while (corpus.HasNext()) {
+        const GeneratedDocument document = corpus.Next();
+        sample_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+
+    const vector<int> ids(sample_server.begin(), sample_server.end());
+    const vector<WordFrequencies> words = sample_server.GetWordFrequencies(ids);
+    set<pair<int, int>> exact_pairs;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        for (size_t j = i + 1; j < ids.size(); ++j) {
+            if (ComputeJaccardSimilarity(words[i], words[j]) >= config.near_duplicate_threshold) {
+                exact_pairs.insert({min(ids[i], ids[j]), max(ids[i], ids[j])});
+            }
+        }
+    }
+    if (exact_pairs.empty()) {
+        return 1.0;
+    }
+    size_t found = 0;
+    for (const NearDuplicatePair& pair : FindNearDuplicates(sample_server, config.near_duplicate_threshold)) {
+        found += exact_pairs.count({pair.first_id, pair.second_id});
+    }
+    return static_cast<double>(found) / exact_pairs.size();
+}
+
+// the breakdown of the index right after it is built goes into the extra values of add_document
+void ReportMemoryUsage(ScenarioResult& result, const MemoryUsage& usage) {
+    result.extra["mem_terms"s] = static_cast<double>(usage.term_dictionary);
+    result.extra["mem_postings"s] = static_cast<double>(usage.postings);
+    result.extra["mem_forward"s] = static_cast<double>(usage.forward_index);
+    result.extra["mem_documents"s] = static_cast<double>(usage.document_metadata);
+    result.extra["mem_stop_words"s] = static_cast<double>(usage.stop_words);
+    result.extra["mem_total"s] = static_cast<double>(usage.GetTotal());
+    result.extra["mem_pool_reserved"s] = static_cast<double>(usage.index_pool_reserved);
+    result.extra["mem_pool_peak"s] = static_cast<double>(usage.index_pool_peak);
+}
+
+// Open-loop arrivals at twice the capacity measured with direct calls, one request in five
+// interactive, each with a queue timeout of deadline_ms. Latency is measured from submission to
+// completion of the served requests; direct_p99_ms is the same arrival schedule served by direct
+// calls on one thread, timed from the intended start so the backlog is not hidden.
+ScenarioResult RunSchedulerOverload(const BenchmarkConfig& config, const SearchServer& search_server,
+                                    size_t document_count, const vector<string>& queries) {
+    using Clock = chrono::steady_clock;
+    const size_t query_count = queries.size();
+    const size_t calibration_count = min<size_t>(query_count, 200);
+    const auto calibration_start = Clock::now();
+    for (size_t i = 0; i < calibration_count; ++i) {
+        search_server.FindTopDocuments(queries[i]);
+    }
+    const double service_ns = static_cast<double>(ToNanoseconds(Clock::now() - calibration_start)) / max<size_t>(calibration_count, 1);
+    const double arrival_interval_ns = service_ns / (2.0 * max(1u, thread::hardware_concurrency()));
+    const auto intended_start = [arrival_interval_ns](Clock::time_point start, size_t i) {
+        return start + chrono::nanoseconds(static_cast<int64_t>(i * arrival_interval_ns));
+    };
+    const auto priority_of = [](size_t i) {
+        return i % 5 == 0 ? RequestPriority::INTERACTIVE : RequestPriority::BATCH;
+    };
+
+    ResetMetrics();
+    vector<future<ScheduledResult>> pending;
+    pending.reserve(query_count);
+    RequestSchedulerStats stats;
+    const auto start_time = Clock::now();
+    {
+        RequestScheduler scheduler(search_server);
+        for (size_t i = 0; i < query_count; ++i) {
+            this_thread::sleep_until(intended_start(start_time, i));
+            pending.push_back(scheduler.Submit(queries[i], priority_of(i), chrono::milliseconds(config.deadline_ms)));
+        }
+        for (auto& result : pending) {
+            result.wait();
+        }
+        stats = scheduler.GetStats();
+    }
+    const double seconds = ToNanoseconds(Clock::now() - start_time) / 1e9;
+
+    vector<int64_t> latencies;
+    vector<int64_t> interactive_latencies;
+    for (size_t i = 0; i < query_count; ++i) {
+        const ScheduledResult result = pending[i].get();
+        if (result.outcome != RequestOutcome::SERVED) {
+            continue;
+        }
+        const int64_t latency = ToNanoseconds(result.queue_time + result.service_time);
+        latencies.push_back(latency);
+        if (priority_of(i) == RequestPriority::INTERACTIVE) {
+            interactive_latencies.push_back(latency);
+        }
+    }
+
+    vector<int64_t> direct_latencies;
+    direct_latencies.reserve(query_count);
+    const auto direct_start = Clock::now();
+    for (size_t i = 0; i < query_count; ++i) {
+        const auto intended = intended_start(direct_start, i);
+        this_thread::sleep_until(intended);
+        search_server.FindTopDocuments(queries[i]);
+        direct_latencies.push_back(ToNanoseconds(Clock::now() - intended));
+    }
+
+    const size_t interactive_index = static_cast<size_t>(RequestPriority::INTERACTIVE);
+    const size_t batch_index = static_cast<size_t>(RequestPriority::BATCH);
+    const size_t interactive_count = (query_count + 4) / 5;
+    const size_t batch_count = query_count - interactive_count;
+    ScenarioResult result;
+    result.scenario = "scheduler_overload"s;
+    result.documents = document_count;
+    result.items = latencies.size();
+    result.seconds = seconds;
+    result.latency = SummarizeLatencies(move(latencies));
+    result.peak_rss_kb = GetPeakRssKb();
+    result.stages = GetMetrics();
+    result.extra["interactive_served_rate"s] = static_cast<double>(stats.served[interactive_index]) / max<size_t>(interactive_count, 1);
+    result.extra["batch_served_rate"s] = static_cast<double>(stats.served[batch_index]) / max<size_t>(batch_count, 1);
+    result.extra["interactive_p99_ms"s] = SummarizeLatencies(move(interactive_latencies)).p99_ns / 1e6;
+    result.extra["direct_p99_ms"s] = SummarizeLatencies(move(direct_latencies)).p99_ns / 1e6;
+    result.extra["final_concurrency_limit"s] = static_cast<double>(stats.concurrency_limit);
+    return result;
+}
+
+vector<ScenarioResult> RunCorpus(const BenchmarkConfig& config, size_t document_count,
+                                 const vector<string>& vocabulary, const vector<string>& queries) {
+    vector<ScenarioResult> results;
+    const auto enabled = [&config](const string& scenario) {
+        return config.scenarios.count(scenario) > 0;
+    };
+    const auto report = [&results](ScenarioResult result) {
+        PrintResult(cerr, result);
+        results.push_back(move(result));
+    };
+
+    const vector<string> stop_words(vocabulary.begin(), vocabulary.begin() + min(config.stop_word_count, vocabulary.size()));
+    auto search_server_holder = make_unique<SearchServer>(stop_words);
+    SearchServer& search_server = *search_server_holder;
+
+    const CorpusConfig corpus_config = MakeCorpusConfig(config, document_count);
+    CorpusGenerator corpus(vocabulary, corpus_config, config.seed + document_count);
+    auto add_result = RunScenario("add_document"s, document_count, document_count, [&](size_t) {
+        const GeneratedDocument document = corpus.Next();
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    });
+    if (enabled("add_document"s)) {
+        ReportMemoryUsage(add_result, search_server.GetMemoryUsage());
+        report(move(add_result));
+    }
+
+    const size_t query_count = queries.size();
+    if (enabled("find_top_seq"s)) {
+        report(RunScenario("find_top_seq"s, document_count, query_count, [&](size_t i) {
+            search_server.FindTopDocuments(execution::seq, queries[i]);
+        }));
+    }
+    if (enabled("find_top_par"s)) {
+        report(RunScenario("find_top_par"s, document_count, query_count, [&](size_t i) {
+            search_server.FindTopDocuments(execution::par, queries[i]);
+        }));
+    }
+    if (enabled("find_top_prepared"s)) {
+        // saved queries are prepared once up front, as an alerting system would do
+        vector<PreparedQuery> prepared_queries;
+        prepared_queries.reserve(query_count);
+        for (size_t i = 0; i < query_count; ++i) {
+            prepared_queries.push_back(search_server.Prepare(queries[i]));
+        }
+        report(RunScenario("find_top_prepared"s, document_count, query_count, [&](size_t i) {
+            search_server.FindTopDocuments(prepared_queries[i]);
+        }));
+    }
+    if (enabled("search_after_pages"s)) {
+        // a UI walking pages 1-50 of ten results, every request carrying the cursor of the previous page
+        SearchCursor cursor;
+        report(RunScenario("search_after_pages"s, document_count, query_count, [&](size_t i) {
+            if (i % 50 == 0) {
+                cursor = SearchCursor();
+            }
+            const auto page = search_server.FindTopDocumentsAfter(queries[i / 50], cursor, 10);
+            if (!page.empty()) {
+                cursor = SearchCursor(page.back());
+            }
+        }));
+    }
+    if (enabled("find_top_async"s)) {
+        // one query at a time through the executor, each with the deadline of the latency objective
+        size_t truncated_count = 0;
+        auto result = RunScenario("find_top_async"s, document_count, query_count, [&](size_t i) {
+            const auto found = search_server.FindTopDocumentsAsync(queries[i], chrono::milliseconds(config.deadline_ms)).get();
+            truncated_count += found.truncated ? 1 : 0;
+        });
+        result.extra["truncated_rate"s] = static_cast<double>(truncated_count) / max<size_t>(query_count, 1);
+        report(move(result));
+    }
+    if (enabled("scheduler_overload"s)) {
+        report(RunSchedulerOverload(config, search_server, document_count, queries));
+    }
+    if (enabled("find_top_all"s)) {
+        report(RunScenario("find_top_all"s, document_count, query_count, [&](size_t i) {
+            search_server.FindTopDocuments(queries[i], MatchMode::ALL);
+        }));
+    }
+    if (enabled("find_top_status"s)) {
+        report(RunScenario("find_top_status"s, document_count, query_count, [&](size_t i) {
+            search_server.FindTopDocuments(queries[i], DocumentStatus::BANNED);
+        }));
+    }
+    if (enabled("find_top_predicate"s)) {
+        report(RunScenario("find_top_predicate"s, document_count, query_count, [&](size_t i) {
+            search_server.FindTopDocuments(queries[i], [](int document_id, DocumentStatus, int rating) {
+                return rating > 0 && document_id % 2 == 0;
+            });
+        }));
+    }
+    // a highly selective filter, the same condition as an opaque predicate and as an index-backed filter
+    if (enabled("find_top_rating_predicate"s)) {
+        report(RunScenario("find_top_rating_predicate"s, document_count, query_count, [&](size_t i) {
+            search_server.FindTopDocuments(queries[i], [](int, DocumentStatus, int rating) {
+                return rating >= 8;
+            });
+        }));
+    }
+    if (enabled("find_top_rating_filter"s)) {
+        DocumentFilter filter;
+        filter.min_rating = 8;
+        report(RunScenario("find_top_rating_filter"s, document_count, query_count, [&](size_t i) {
+            search_server.FindTopDocuments(queries[i], filter);
+        }));
+    }
+
+    mt19937_64 generator(config.seed);
+    uniform_int_distribution<int> document_distribution(0, static_cast<int>(document_count) - 1);
+    if (enabled("match_document"s)) {
+        report(RunScenario("match_document"s, document_count, query_count, [&](size_t i) {
+            search_server.MatchDocument(queries[i], document_distribution(generator));
+        }));
+    }
+    if (enabled("match_document_par"s)) {
+        report(RunScenario("match_document_par"s, document_count, query_count, [&](size_t i) {
+            search_server.MatchDocument(execution::par, queries[i], document_distribution(generator));
+        }));
+    }
+    if (enabled("match_documents_batch"s) || enabled("match_documents_batch_par"s)) {
+        // one query against a few hundred candidates, as a highlighting request does
+        const size_t batch_size = min<size_t>(500, document_count);
+        const size_t batch_count = max<size_t>(1, query_count / batch_size);
+        vector<vector<int>> candidates(batch_count);
+        for (auto& ids : candidates) {
+            for (size_t j = 0; j < batch_size; ++j) {
+                ids.push_back(document_distribution(generator));
+            }
+        }
+        if (enabled("match_documents_batch"s)) {
+            report(RunScenario("match_documents_batch"s, document_count, batch_count, [&](size_t i) {
+                search_server.MatchDocuments(queries[i], candidates[i]);
+            }, batch_size));
+        }
+        if (enabled("match_documents_batch_par"s)) {
+            report(RunScenario("match_documents_batch_par"s, document_count, batch_count, [&](size_t i) {
+                search_server.MatchDocuments(execution::par, queries[i], candidates[i]);
+            }, batch_size));
+        }
+    }
+    if (enabled("process_queries"s)) {
+        const size_t batch_size = 1'000;
+        vector<vector<string>> batches;
+        for (size_t begin = 0; begin < query_count; begin += batch_size) {
+            batches.emplace_back(queries.begin() + begin, queries.begin() + min(query_count, begin + batch_size));
+        }
+        report(RunScenario("process_queries"s, document_count, batches.size(), [&](size_t i) {
+            ProcessQueries(search_server, batches[i]);
+        }, batch_size));
+    }
+    // a feature extraction pass: every word of every document is read from the forward index
+    if (enabled("word_frequencies"s) || enabled("word_frequencies_batch"s)) {
+        const vector<int> ids(search_server.begin(), search_server.end());
+        // the sum keeps the reads from being optimized away
+        double checksum = 0.0;
+        if (enabled("word_frequencies"s)) {
+            report(RunScenario("word_frequencies"s, document_count, ids.size(), [&](size_t i) {
+                for (const auto& [word, term_freq] : search_server.GetWordFrequencies(ids[i])) {
+                    checksum += term_freq * word.size();
+                }
+            }));
+        }
+        if (enabled("word_frequencies_batch"s)) {
+            report(RunScenario("word_frequencies_batch"s, document_count, 1, [&](size_t) {
+                for (const WordFrequencies& words : search_server.GetWordFrequencies(ids)) {
+                    for (const auto& [word, term_freq] : words) {
+                        checksum += term_freq * word.size();
+                    }
+                }
+            }, ids.size()));
+        }
+    }
+    if (enabled("near_duplicates"s)) {
+        SearchServer near_duplicate_server(stop_words);
+        CorpusGenerator near_duplicate_corpus(vocabulary, MakeCorpusConfig(config, document_count, config.near_duplicate_rate),
+                                              config.seed + document_count);
+        while (near_duplicate_corpus.HasNext()) {
+            const GeneratedDocument document = near_duplicate_corpus.Next();
+            near_duplicate_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+        vector<NearDuplicatePair> pairs;
+        auto result = RunScenario("near_duplicates"s, document_count, 1, [&](size_t) {
+            pairs = FindNearDuplicates(near_duplicate_server, config.near_duplicate_threshold);
+        });
+        result.extra["pairs"s] = static_cast<double>(pairs.size());
+        result.extra["recall"s] = MeasureNearDuplicateRecall(config, document_count, vocabulary, stop_words);
+        report(move(result));
+    }
+    if (enabled("remove_duplicates"s)) {
+        // RemoveDuplicates reports every removed id to stdout
+        ostringstream discarded;
+        auto* const cout_buffer = cout.rdbuf(discarded.rdbuf());
+        report(RunScenario("remove_duplicates"s, document_count, 1, [&](size_t) {
+            RemoveDuplicates(search_server);
+        }));
+        cout.rdbuf(cout_buffer);
+    }
+    if (enabled("remove_document"s)) {
+        const size_t remove_count = min(config.remove_count, document_count);
+        vector<int> ids(search_server.begin(), search_server.end());
+        shuffle(ids.begin(), ids.end(), generator);
+        report(RunScenario("remove_document"s, document_count, min(remove_count, ids.size()), [&](size_t i) {
+            search_server.RemoveDocument(ids[i]);
+        }));
+    }
+    if (enabled("teardown"s)) {
+        report(RunScenario("teardown"s, document_count, 1, [&](size_t) {
+            search_server_holder.reset();
+        }));
+    }
+    return results;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkConfig config;
+    try {
+        config = ParseArguments(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        cerr << "usage: benchmark [--docs=10000,100000] [--vocab=N] [--zipf=S] [--queries=N] [--query-words=N]"s
+             << " [--minus-prob=P] [--min-words=N] [--max-words=N] [--dup-rate=P] [--near-dup-rate=P]"s
+             << " [--near-dup-threshold=J] [--exact-limit=N] [--stop-words=N] [--remove=N]"s
+             << " [--seed=N] [--deadline-ms=N] [--scenarios=a,b] [--json=path|-]"s << endl;
+        return 1;
+    }
+
+    mt19937_64 generator(config.seed);
+    const vector<string> vocabulary = GenerateVocabulary(generator, config.vocabulary_size, 12);
+    const vector<string> queries = GenerateZipfQueries(generator, vocabulary, config.query_count, config.zipf_exponent,
+                                                       config.max_query_words, config.minus_prob);
+
+    vector<ScenarioResult> results;
+    for (const size_t document_count : config.document_counts) {
+        for (auto& result : RunCorpus(config, document_count, vocabulary, queries)) {
+            results.push_back(move(result));
+        }
+    }
+
+    if (config.json_path == "-"s) {
+        WriteJson(cout, config, results);
+    } else if (!config.json_path.empty()) {
+        ofstream out(config.json_path);
+        WriteJson(out, config, results);
+    }
+    return 0;
+}
@@ -0,0 +1,301 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "workload.h"
+#include "../search_server.h"
+#include "../process_queries.h"
+#include "../read_input_functions.h"
+
+using namespace std;
+
+// Corpus file: the first line holds the number of documents, then one document per line:
+//     text[<TAB>status[<TAB>rating,rating,...]]
+// Query log: one query per line:
+//     query[<TAB>status[<TAB>timestamp_ms]]
+// status is either a name (ACTUAL, IRRELEVANT, BANNED, REMOVED) or its numeric value.
+
+struct ReplayConfig {
+    string corpus_path;
+    string queries_path;
+    string stop_words;
+    int threads = 1;
+    double target_qps = 0.0;
+    bool use_timestamps = false;
+    double speed = 1.0;
+    int repeat = 1;
+    bool batch = false;
+    string json_path;
+};
+
+struct LoggedQuery {
+    string text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int64_t timestamp_ns = -1;
+};
+
+struct ReplayResult {
+    size_t completed = 0;
+    size_t errors = 0;
+    double seconds = 0.0;
+    LatencySummary response_time;
+    LatencySummary service_time;
+};
+
+vector<string> SplitByTab(const string& line) {
+    vector<string> fields;
+    stringstream stream(line);
+    for (string field; getline(stream, field, '\t');) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+DocumentStatus ParseStatus(const string& text) {
+    if (text.empty() || text == "ACTUAL"s || text == "0"s) return DocumentStatus::ACTUAL;
+    if (text == "IRRELEVANT"s || text == "1"s) return DocumentStatus::IRRELEVANT;
+    if (text == "BANNED"s || text == "2"s) return DocumentStatus::BANNED;
+    if (text == "REMOVED"s || text == "3"s) return DocumentStatus::REMOVED;
+    throw invalid_argument("unknown document status "s + text);
+}
+
+void LoadCorpus(const string& path, SearchServer& search_server) {
+    ifstream input(path);
+    if (!input) throw invalid_argument("can not open corpus file "s + path);
+    const int document_count = ReadLineWithNumber(input);
+    for (int id = 0; id < document_count && input; ++id) {
+        const vector<string> fields = SplitByTab(ReadLine(input));
+        if (fields.empty()) continue;
+        vector<int> ratings;
+        if (fields.size() > 2) {
+            stringstream stream(fields[2]);
+            for (string rating; getline(stream, rating, ',');) {
+                ratings.push_back(stoi(rating));
+            }
+        }
+        search_server.AddDocument(id, fields[0], fields.size() > 1 ? ParseStatus(fields[1]) : DocumentStatus::ACTUAL, ratings);
+    }
+}
+
+vector<LoggedQuery> LoadQueryLog(const string& path) {
+    ifstream input(path);
+    if (!input) throw invalid_argument("can not open query log "s + path);
+    vector<LoggedQuery> queries;
+    int64_t first_timestamp = -1;
+    while (input) {
+        const string line = ReadLine(input);
+        if (line.empty()) continue;
+        const vector<string> fields = SplitByTab(line);
+        LoggedQuery query;
+        query.text = fields[0];
+        if (fields.size() > 1) {
+            query.status = ParseStatus(fields[1]);
+        }
+        if (fields.size() > 2) {
+            const int64_t timestamp = static_cast<int64_t>(stod(fields[2]) * 1e6);
+            if (first_timestamp < 0) first_timestamp = timestamp;
+            query.timestamp_ns = timestamp - first_timestamp;
+        }
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
+ReplayConfig ParseArguments(int argc, char** argv) {
+    ReplayConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        const size_t equals = argument.find('=');
+        const string key = argument.substr(0, equals);
+        const string value = equals == string::npos ? ""s : argument.substr(equals + 1);
+        if (key == "--corpus"s) {
+            config.corpus_path = value;
+        } else if (key == "--queries"s) {
+            config.queries_path = value;
+        } else if (key == "--stop-words"s) {
+            config.stop_words = value;
+        } else if (key == "--threads"s) {
+            config.threads = stoi(value);
+        } else if (key == "--qps"s) {
+            config.target_qps = stod(value);
+        } else if (key == "--timestamps"s) {
+            config.use_timestamps = true;
+        } else if (key == "--speed"s) {
+            config.speed = stod(value);
+        } else if (key == "--repeat"s) {
+            config.repeat = stoi(value);
+        } else if (key == "--batch"s) {
+            config.batch = true;
+        } else if (key == "--json"s) {
+            config.json_path = value;
+        } else {
+            throw invalid_argument("unknown argument "s + argument);
+        }
+    }
+    if (config.corpus_path.empty() || config.queries_path.empty()) {
+        throw invalid_argument("--corpus and --queries are required"s);
+    }
+    if (config.threads < 1 || config.repeat < 1 || config.speed <= 0.0) {
+        throw invalid_argument("--threads, --repeat and --speed must be positive"s);
+    }
+    return config;
+}
+
+int64_t ToNanoseconds(chrono::steady_clock::duration duration) {
+    return chrono::duration_cast<chrono::nanoseconds>(duration).count();
+}
+
+// In open-loop mode every request has an intended start time. Latency is measured from that
+// moment rather than from the actual start, so time spent waiting behind slow requests is not
+// lost (coordinated omission correction).
+ReplayResult Replay(const ReplayConfig& config, const SearchServer& search_server, const vector<LoggedQuery>& queries) {
+    using Clock = chrono::steady_clock;
+    const size_t total = queries.size() * config.repeat;
+    const bool open_loop = config.target_qps > 0.0 || config.use_timestamps;
+    const int64_t log_span_ns = queries.empty() || queries.back().timestamp_ns < 0 ? 0 : queries.back().timestamp_ns + 1;
+
+    const auto intended_offset_ns = [&](size_t k) -> int64_t {
+        if (config.use_timestamps) {
+            const size_t round = k / queries.size();
+            const int64_t timestamp = max<int64_t>(queries[k % queries.size()].timestamp_ns, 0);
+            return static_cast<int64_t>((round * log_span_ns + timestamp) / config.speed);
+        }
+        return static_cast<int64_t>(k * 1e9 / config.target_qps);
+    };
+
+    atomic<size_t> next_request{0};
+    atomic<size_t> errors{0};
+    vector<vector<int64_t>> response_times(config.threads);
+    vector<vector<int64_t>> service_times(config.threads);
+    const auto start_time = Clock::now();
+
+    vector<thread> workers;
+    for (int t = 0; t < config.threads; ++t) {
+        workers.emplace_back([&, t]() {
+            for (size_t k = next_request.fetch_add(1); k < total; k = next_request.fetch_add(1)) {
+                const LoggedQuery& query = queries[k % queries.size()];
+                const auto intended_start = open_loop ? start_time + chrono::nanoseconds(intended_offset_ns(k)) : Clock::now();
+                if (open_loop) {
+                    this_thread::sleep_until(intended_start);
+                }
+                const auto actual_start = Clock::now();
+                try {
+                    search_server.FindTopDocuments(query.text, query.status);
+                } catch (const invalid_argument&) {
+                    errors.fetch_add(1);
+                }
+                const auto end_time = Clock::now();
+                response_times[t].push_back(ToNanoseconds(end_time - intended_start));
+                service_times[t].push_back(ToNanoseconds(end_time - actual_start));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    ReplayResult result;
+    result.seconds = ToNanoseconds(Clock::now() - start_time) / 1e9;
+    result.errors = errors.load();
+    vector<int64_t> all_response_times;
+    vector<int64_t> all_service_times;
+    for (int t = 0; t < config.threads; ++t) {
+        all_response_times.insert(all_response_times.end(), response_times[t].begin(), response_times[t].end());
+        all_service_times.insert(all_service_times.end(), service_times[t].begin(), service_times[t].end());
+    }
+    result.completed = all_response_times.size();
+    result.response_time = SummarizeLatencies(move(all_response_times));
+    result.service_time = SummarizeLatencies(move(all_service_times));
+    return result;
+}
+
+ReplayResult ReplayBatch(const ReplayConfig& config, const SearchServer& search_server, const vector<LoggedQuery>& queries) {
+    vector<string> texts;
+    texts.reserve(queries.size());
+    for (const LoggedQuery& query : queries) {
+        texts.push_back(query.text);
+    }
+    vector<int64_t> batch_times;
+    const auto start_time = chrono::steady_clock::now();
+    for (int round = 0; round < config.repeat; ++round) {
+        const auto batch_start = chrono::steady_clock::now();
+        ProcessQueries(search_server, texts);
+        batch_times.push_back(ToNanoseconds(chrono::steady_clock::now() - batch_start));
+    }
+    ReplayResult result;
+    result.seconds = ToNanoseconds(chrono::steady_clock::now() - start_time) / 1e9;
+    result.completed = texts.size() * config.repeat;
+    result.response_time = SummarizeLatencies(batch_times);
+    result.service_time = result.response_time;
+    return result;
+}
+
+void PrintSummary(ostream& out, const string& name, const LatencySummary& summary) {
+    out << left << setw(14) << name << right
+        << " mean="s << static_cast<int64_t>(summary.mean_ns) << "ns"s
+        << " p50="s << summary.p50_ns << "ns"s
+        << " p90="s << summary.p90_ns << "ns"s
+        << " p99="s << summary.p99_ns << "ns"s
+        << " p999="s << summary.p999_ns << "ns"s
+        << " max="s << summary.max_ns << "ns"s << endl;
+}
+
+void WriteSummaryJson(ostream& out, const LatencySummary& summary) {
+    out << "{\"mean\": "s << summary.mean_ns << ", \"p50\": "s << summary.p50_ns << ", \"p90\": "s << summary.p90_ns
+        << ", \"p99\": "s << summary.p99_ns << ", \"p999\": "s << summary.p999_ns << ", \"max\": "s << summary.max_ns << "}"s;
+}
+
+void WriteJson(ostream& out, const ReplayConfig& config, const ReplayResult& result) {
+    out << "{\"threads\": "s << config.threads
+        << ", \"target_qps\": "s << config.target_qps
+        << ", \"mode\": \""s << (config.batch ? "batch"s : config.use_timestamps ? "timestamps"s : config.target_qps > 0 ? "open_loop"s : "closed_loop"s) << "\""s
+        << ", \"completed\": "s << result.completed
+        << ", \"errors\": "s << result.errors
+        << ", \"seconds\": "s << result.seconds
+        << ", \"throughput\": "s << (result.seconds > 0 ? result.completed / result.seconds : 0.0)
+        << ", \"response_time_ns\": "s;
+    WriteSummaryJson(out, result.response_time);
+    out << ", \"service_time_ns\": "s;
+    WriteSummaryJson(out, result.service_time);
+    out << "}\n"s;
+}
+
+int main(int argc, char** argv) {
+    try {
+        const ReplayConfig config = ParseArguments(argc, argv);
+        SearchServer search_server(config.stop_words);
+        LoadCorpus(config.corpus_path, search_server);
+        const vector<LoggedQuery> queries = LoadQueryLog(config.queries_path);
+        if (queries.empty()) throw invalid_argument("query log is empty"s);
+        cerr << "loaded "s << search_server.GetDocumentCount() << " documents and "s << queries.size() << " queries"s << endl;
+
+        const ReplayResult result = config.batch ? ReplayBatch(config, search_server, queries)
+                                                 : Replay(config, search_server, queries);
+        cerr << "completed="s << result.completed << " errors="s << result.errors
+             << " seconds="s << result.seconds
+             << " throughput="s << (result.seconds > 0 ? result.completed / result.seconds : 0.0) << " qps"s << endl;
+        PrintSummary(cerr, config.batch ? "batch"s : "response_time"s, result.response_time);
+        if (!config.batch) {
+            PrintSummary(cerr, "service_time"s, result.service_time);
+        }
+
+        if (config.json_path == "-"s) {
+            WriteJson(cout, config, result);
+        } else if (!config.json_path.empty()) {
+            ofstream out(config.json_path);
+            WriteJson(out, config, result);
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        cerr << "usage: query_replay --corpus=path --queries=path [--stop-words=\"a b\"] [--threads=N]"s
+             << " [--qps=X | --timestamps [--speed=X]] [--repeat=N] [--batch] [--json=path|-]"s << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../scoring_kernels.h"
+
+using namespace std;
+
+// Scores one posting list into a dense accumulator with every kernel the CPU supports, on one thread.
+// Postings are sorted distinct document ids with random term frequencies, scored block by block the way
+// SearchServer does; the accumulation map the dense path replaces is measured for comparison.
+
+struct KernelBenchmarkConfig {
+    size_t documents = 1'000'000;
+    size_t postings = 100'000;
+    int repeat = 50;
+    unsigned seed = 42;
+};
+
+KernelBenchmarkConfig ParseArguments(int argc, char** argv) {
+    KernelBenchmarkConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const string argument = argv[i];
+        const size_t equals = argument.find('=');
+        const string key = argument.substr(0, equals);
+        const string value = equals == string::npos ? ""s : argument.substr(equals + 1);
+        if (key == "--documents"s) {
+            config.documents = stoull(value);
+        } else if (key == "--postings"s) {
+            config.postings = stoull(value);
+        } else if (key == "--repeat"s) {
+            config.repeat = stoi(value);
+        } else if (key == "--seed"s) {
+            config.seed = static_cast<unsigned>(stoul(value));
+        } else {
+            throw invalid_argument("unknown argument "s + argument);
+        }
+    }
+    if (config.postings == 0 || config.postings > config.documents || config.repeat < 1) {
+        throw invalid_argument("--postings must be in [1, documents] and --repeat positive"s);
+    }
+    return config;
+}
+
+void PrintRate(const string& name, size_t postings, double seconds) {
+    cout << left << setw(10) << name << right
+         << " postings/s="s << setw(14) << fixed << setprecision(0) << postings / seconds
+         << " ns/posting="s << setprecision(3) << seconds * 1e9 / postings << endl;
+}
+
+int main(int argc, char** argv) {
+    try {
+        const KernelBenchmarkConfig config = ParseArguments(argc, argv);
+        mt19937 generator(config.seed);
+        vector<int> document_ids(config.documents);
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            document_ids[i] = static_cast<int>(i);
+        }
+        shuffle(document_ids.begin(), document_ids.end(), generator);
+        document_ids.resize(config.postings);
+        sort(document_ids.begin(), document_ids.end());
+        vector<double> term_freqs(config.postings);
+        uniform_real_distribution<double> frequency(0.01, 1.0);
+        for (double& term_freq : term_freqs) {
+            term_freq = frequency(generator);
+        }
+        const double inverse_document_freq = 1.7;
+        const size_t total_postings = config.postings * config.repeat;
+
+        vector<double> expected;
+        for (const ScoringKernel kernel : GetSupportedScoringKernels()) {
+            vector<double> relevances(config.documents, 0.0);
+            const auto start = chrono::steady_clock::now();
+            for (int round = 0; round < config.repeat; ++round) {
+                for (size_t begin = 0; begin < config.postings; begin += SCORING_BLOCK_SIZE) {
+                    AccumulateScores(kernel, document_ids.data() + begin, term_freqs.data() + begin,
+                                     min(SCORING_BLOCK_SIZE, config.postings - begin), inverse_document_freq, relevances.data());
+                }
+            }
+            PrintRate(string(GetScoringKernelName(kernel)), total_postings,
+                      chrono::duration<double>(chrono::steady_clock::now() - start).count());
+            if (expected.empty()) {
+                expected = move(relevances);
+            } else if (relevances != expected) {
+                cout << "  results differ from the scalar kernel"s << endl;
+                return 1;
+            }
+        }
+
+        map<int, double> document_to_relevance;
+        const auto start = chrono::steady_clock::now();
+        for (int round = 0; round < config.repeat; ++round) {
+            for (size_t i = 0; i < config.postings; ++i) {
+                document_to_relevance[document_ids[i]] += term_freqs[i] * inverse_document_freq;
+            }
+        }
+        PrintRate("map"s, total_postings, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        cout << "active kernel: "s << GetScoringKernelName(GetActiveScoringKernel()) << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        cerr << "usage: scoring_kernels [--documents=N] [--postings=N] [--repeat=N] [--seed=N]"s << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_set>
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+#include "workload.h"
+
+using namespace std::string_literals;
+
+ZipfDistribution::ZipfDistribution(size_t n, double exponent)
+    : cdf_(n) {
+    if (n == 0) throw std::invalid_argument("zipf distribution must have at least one rank"s);
+    double sum = 0.0;
+    for (size_t rank = 0; rank < n; ++rank) {
+        sum += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+        cdf_[rank] = sum;
+    }
+    for (double& value : cdf_) {
+        value /= sum;
+    }
+}
+
+size_t ZipfDistribution::operator()(std::mt19937_64& generator) const {
+    const double value = std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+    const auto it = std::lower_bound(cdf_.begin(), cdf_.end(), value);
+    return std::min(static_cast<size_t>(it - cdf_.begin()), cdf_.size() - 1);
+}
+
+size_t ZipfDistribution::size() const {
+    return cdf_.size();
+}
+
+std::vector<std::string> GenerateVocabulary(std::mt19937_64& generator, size_t word_count, int max_length) {
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> words;
+    words.reserve(word_count);
+    std::uniform_int_distribution<int> length_distribution(2, max_length);
+    std::uniform_int_distribution<int> letter_distribution('a', 'z');
+    while (words.size() < word_count) {
+        std::string word(length_distribution(generator), ' ');
+        for (char& c : word) {
+            c = static_cast<char>(letter_distribution(generator));
+        }
+        if (seen.insert(word).second) {
+            words.push_back(std::move(word));
+        }
+    }
+    return words;
+}
+
+CorpusGenerator::CorpusGenerator(const std::vector<std::string>& vocabulary, const CorpusConfig& config, uint64_t seed)
+    : vocabulary_(vocabulary)
+    , config_(config)
+    , generator_(seed)
+    , word_distribution_(vocabulary.size(), config.zipf_exponent) {
+}
+
+bool CorpusGenerator::HasNext() const {
+    return generated_ < config_.document_count;
+}
+
+GeneratedDocument CorpusGenerator::Next() {
+    const int id = static_cast<int>(generated_++);
+    std::vector<size_t> words;
+    // one draw decides the kind of the document, as before near-duplicates were added, so a corpus
+    // without near-duplicates is the same for a given seed
+    const double kind = recent_documents_.empty() ? 1.0 : std::uniform_real_distribution<double>(0.0, 1.0)(generator_);
+    const bool duplicate = kind < config_.duplicate_rate;
+    const bool near_duplicate = !duplicate && kind < config_.duplicate_rate + config_.near_duplicate_rate;
+    if (duplicate || near_duplicate) {
+        words = recent_documents_[std::uniform_int_distribution<size_t>(0, recent_documents_.size() - 1)(generator_)];
+        std::shuffle(words.begin(), words.end(), generator_);
+        if (near_duplicate) {
+            for (size_t& word : words) {
+                if (std::uniform_real_distribution<double>(0.0, 1.0)(generator_) < config_.near_duplicate_mutation) {
+                    word = word_distribution_(generator_);
+                }
+            }
+        }
+    } else {
+        const int word_count = std::uniform_int_distribution<int>(config_.min_words, config_.max_words)(generator_);
+        words.reserve(word_count);
+        for (int i = 0; i < word_count; ++i) {
+            words.push_back(word_distribution_(generator_));
+        }
+        recent_documents_.push_back(words);
+        if (recent_documents_.size() > 64) {
+            recent_documents_.pop_front();
+        }
+    }
+
+    GeneratedDocument document;
+    document.id = id;
+    for (const size_t word : words) {
+        if (!document.text.empty()) {
+            document.text.push_back(' ');
+        }
+        document.text += vocabulary_[word];
+    }
+    const int status = std::uniform_int_distribution<int>(0, 9)(generator_);
+    document.status = status < 7 ? DocumentStatus::ACTUAL
+                    : status < 8 ? DocumentStatus::IRRELEVANT
+                    : status < 9 ? DocumentStatus::BANNED
+                                 : DocumentStatus::REMOVED;
+    const int rating_count = std::uniform_int_distribution<int>(1, 5)(generator_);
+    for (int i = 0; i < rating_count; ++i) {
+        document.ratings.push_back(std::uniform_int_distribution<int>(-10, 10)(generator_));
+    }
+    return document;
+}
+
+std::vector<std::string> GenerateZipfQueries(std::mt19937_64& generator, const std::vector<std::string>& vocabulary,
+                                             size_t query_count, double zipf_exponent, int max_word_count,
+                                             double minus_prob) {
+    const ZipfDistribution word_distribution(vocabulary.size(), zipf_exponent);
+    const ZipfDistribution length_distribution(max_word_count, zipf_exponent);
+    std::vector<std::string> queries;
+    queries.reserve(query_count);
+    for (size_t i = 0; i < query_count; ++i) {
+        const size_t word_count = length_distribution(generator) + 1;
+        std::string query;
+        for (size_t j = 0; j < word_count; ++j) {
+            if (!query.empty()) {
+                query.push_back(' ');
+            }
+            if (std::uniform_real_distribution<double>(0.0, 1.0)(generator) < minus_prob) {
+                query.push_back('-');
+            }
+            query += vocabulary[word_distribution(generator)];
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+LatencySummary SummarizeLatencies(std::vector<int64_t> samples_ns) {
+    LatencySummary summary;
+    if (samples_ns.empty()) {
+        return summary;
+    }
+    std::sort(samples_ns.begin(), samples_ns.end());
+    const auto at_percentile = [&samples_ns](double percentile) {
+        const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * samples_ns.size()));
+        return samples_ns[std::min(samples_ns.size(), std::max<size_t>(rank, 1)) - 1];
+    };
+    summary.count = samples_ns.size();
+    summary.mean_ns = std::accumulate(samples_ns.begin(), samples_ns.end(), 0.0) / samples_ns.size();
+    summary.p50_ns = at_percentile(50.0);
+    summary.p90_ns = at_percentile(90.0);
+    summary.p99_ns = at_percentile(99.0);
+    summary.p999_ns = at_percentile(99.9);
+    summary.max_ns = samples_ns.back();
+    return summary;
+}
+
+long GetPeakRssKb() {
+#ifdef __linux__
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+    return 0;
+}
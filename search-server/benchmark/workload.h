@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include "../document.h"
+
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t n, double exponent);
+    // returns a rank in [0, n), rank 0 being the most frequent one
+    size_t operator()(std::mt19937_64& generator) const;
+    size_t size() const;
+
+private:
+    std::vector<double> cdf_;
+};
+
+std::vector<std::string> GenerateVocabulary(std::mt19937_64& generator, size_t word_count, int max_length);
+
+struct CorpusConfig {
+    size_t document_count = 10'000;
+    double zipf_exponent = 1.0;
+    int min_words = 10;
+    int max_words = 100;
+    double duplicate_rate = 0.0;
+    double near_duplicate_rate = 0.0;
+    double near_duplicate_mutation = 0.1;
+};
+
+struct GeneratedDocument {
+    int id;
+    std::string text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
+// Streams documents one by one so that corpora of millions of documents never have to be kept in memory.
+class CorpusGenerator {
+public:
+    CorpusGenerator(const std::vector<std::string>& vocabulary, const CorpusConfig& config, uint64_t seed);
+    bool HasNext() const;
+    GeneratedDocument Next();
+
+private:
+    const std::vector<std::string>& vocabulary_;
+    const CorpusConfig config_;
+    std::mt19937_64 generator_;
+    ZipfDistribution word_distribution_;
+    std::deque<std::vector<size_t>> recent_documents_;
+    size_t generated_ = 0;
+};
+
+std::vector<std::string> GenerateZipfQueries(std::mt19937_64& generator, const std::vector<std::string>& vocabulary,
+                                             size_t query_count, double zipf_exponent, int max_word_count,
+                                             double minus_prob = 0.0);
+
+struct LatencySummary {
+    size_t count = 0;
+    double mean_ns = 0.0;
+    int64_t p50_ns = 0;
+    int64_t p90_ns = 0;
+    int64_t p99_ns = 0;
+    int64_t p999_ns = 0;
+    int64_t max_ns = 0;
+};
+
+LatencySummary SummarizeLatencies(std::vector<int64_t> samples_ns);
+
+long GetPeakRssKb();
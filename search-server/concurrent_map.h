@@ -1,5 +1,6 @@
 #pragma once
 #include <algorithm>
+#include <execution>
 #include <map>
 #include <string>
 #include <vector>
@@ -44,6 +45,20 @@ public:
         }
         return ordinary_map;
     };
+    
+    // Calls function(bucket_index, bucket) for every bucket in parallel, each under its own lock.
+    // A key lives in the bucket key % bucket count, so the buckets partition the keys.
+    template <typename Function>
+    void ForEachBucket(std::execution::parallel_policy policy, Function function) {
+        std::for_each(std::execution::par, buckets_.begin(), buckets_.end(), [this, &function](MutexAndBucket& element) {
+            std::lock_guard<std::mutex> lock(element.m);
+            function(static_cast<size_t>(&element - buckets_.data()), element.bucket);
+        });
+    }
+    
+    size_t GetBucketCount() const {
+        return bucket_count_;
+    }
 
 private:
     const size_t bucket_count_;
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include "document_bitmap.h"
+
+void DocumentBitmap::Block::Set(uint16_t low) {
+    if (!bits.empty()) {
+        bits[low / 64] |= uint64_t{1} << (low % 64);
+        return;
+    }
+    const auto position = std::lower_bound(ids.begin(), ids.end(), low);
+    if (position == ids.end() || *position != low) {
+        ids.insert(position, low);
+        if (ids.size() > MAX_ARRAY_SIZE) {
+            ConvertToBitmap();
+        }
+    }
+}
+
+void DocumentBitmap::Block::Reset(uint16_t low) {
+    if (!bits.empty()) {
+        bits[low / 64] &= ~(uint64_t{1} << (low % 64));
+        return;
+    }
+    const auto position = std::lower_bound(ids.begin(), ids.end(), low);
+    if (position != ids.end() && *position == low) {
+        ids.erase(position);
+    }
+}
+
+void DocumentBitmap::Block::ConvertToBitmap() {
+    if (!bits.empty()) {
+        return;
+    }
+    bits.assign(BLOCK_WORDS, 0);
+    for (const uint16_t low : ids) {
+        bits[low / 64] |= uint64_t{1} << (low % 64);
+    }
+    ids.clear();
+    ids.shrink_to_fit();
+}
+
+size_t DocumentBitmap::Block::Count() const {
+    return std::accumulate(bits.begin(), bits.end(), ids.size(), [](size_t count, uint64_t word) {
+        return count + __builtin_popcountll(word);
+    });
+}
+
+void DocumentBitmap::Set(int document_id) {
+    GetOrAddBlock(static_cast<size_t>(document_id) >> BLOCK_BITS).Set(static_cast<uint16_t>(document_id));
+}
+
+void DocumentBitmap::Reset(int document_id) {
+    const size_t key = static_cast<size_t>(document_id) >> BLOCK_BITS;
+    if (key < directory_.size() && directory_[key] != NO_BLOCK) {
+        blocks_[directory_[key]].Reset(static_cast<uint16_t>(document_id));
+    }
+}
+
+DocumentBitmap& DocumentBitmap::operator|=(const DocumentBitmap& other) {
+    for (size_t key = 0; key < other.directory_.size(); ++key) {
+        if (other.directory_[key] == NO_BLOCK) continue;
+        const Block& source = other.blocks_[other.directory_[key]];
+        if (source.ids.empty() && source.bits.empty()) continue;
+        Block& target = GetOrAddBlock(key);
+        if (!source.bits.empty()) {
+            target.ConvertToBitmap();
+            for (size_t i = 0; i < BLOCK_WORDS; ++i) {
+                target.bits[i] |= source.bits[i];
+            }
+        } else if (!target.bits.empty()) {
+            for (const uint16_t low : source.ids) {
+                target.bits[low / 64] |= uint64_t{1} << (low % 64);
+            }
+        } else {
+            std::vector<uint16_t> merged;
+            merged.reserve(target.ids.size() + source.ids.size());
+            std::set_union(target.ids.begin(), target.ids.end(), source.ids.begin(), source.ids.end(),
+                           std::back_inserter(merged));
+            target.ids = std::move(merged);
+            if (target.ids.size() > MAX_ARRAY_SIZE) {
+                target.ConvertToBitmap();
+            }
+        }
+    }
+    return *this;
+}
+
+void DocumentBitmap::KeepRange(int first_id, int last_id) {
+    // ids are never negative, so a range reaching below zero starts at zero
+    first_id = std::max(first_id, 0);
+    if (first_id > last_id) {
+        directory_.clear();
+        blocks_.clear();
+        return;
+    }
+    const size_t first_key = static_cast<size_t>(first_id) >> BLOCK_BITS;
+    const size_t last_key = static_cast<size_t>(last_id) >> BLOCK_BITS;
+    const size_t low_mask = (size_t{1} << BLOCK_BITS) - 1;
+    for (size_t key = 0; key < directory_.size(); ++key) {
+        if (directory_[key] == NO_BLOCK) continue;
+        Block& block = blocks_[directory_[key]];
+        if (key < first_key || key > last_key) {
+            block = Block();
+            continue;
+        }
+        const size_t low_first = key == first_key ? static_cast<size_t>(first_id) & low_mask : 0;
+        const size_t low_last = key == last_key ? static_cast<size_t>(last_id) & low_mask : low_mask;
+        if (block.bits.empty()) {
+            block.ids.erase(std::upper_bound(block.ids.begin(), block.ids.end(), low_last), block.ids.end());
+            block.ids.erase(block.ids.begin(), std::lower_bound(block.ids.begin(), block.ids.end(), low_first));
+            continue;
+        }
+        std::fill(block.bits.begin(), block.bits.begin() + low_first / 64, 0);
+        block.bits[low_first / 64] &= ~uint64_t{0} << (low_first % 64);
+        std::fill(block.bits.begin() + low_last / 64 + 1, block.bits.end(), 0);
+        if (low_last % 64 != 63) {
+            block.bits[low_last / 64] &= (uint64_t{1} << (low_last % 64 + 1)) - 1;
+        }
+    }
+}
+
+size_t DocumentBitmap::Count() const {
+    return std::accumulate(blocks_.begin(), blocks_.end(), size_t{0}, [](size_t count, const Block& block) {
+        return count + block.Count();
+    });
+}
+
+size_t DocumentBitmap::GetMemoryUsage() const {
+    size_t memory = directory_.capacity() * sizeof(uint32_t) + blocks_.capacity() * sizeof(Block);
+    for (const Block& block : blocks_) {
+        memory += block.ids.capacity() * sizeof(uint16_t) + block.bits.capacity() * sizeof(uint64_t);
+    }
+    return memory;
+}
+
+std::vector<int> DocumentBitmap::GetDocumentIds() const {
+    std::vector<int> document_ids;
+    document_ids.reserve(Count());
+    for (size_t key = 0; key < directory_.size(); ++key) {
+        if (directory_[key] == NO_BLOCK) continue;
+        const Block& block = blocks_[directory_[key]];
+        const size_t base = key << BLOCK_BITS;
+        for (const uint16_t low : block.ids) {
+            document_ids.push_back(static_cast<int>(base + low));
+        }
+        for (size_t i = 0; i < block.bits.size(); ++i) {
+            for (uint64_t word = block.bits[i]; word != 0; word &= word - 1) {
+                document_ids.push_back(static_cast<int>(base + i * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+    return document_ids;
+}
+
+DocumentBitmap::Block& DocumentBitmap::GetOrAddBlock(size_t key) {
+    if (key >= directory_.size()) {
+        directory_.resize(key + 1, NO_BLOCK);
+    }
+    if (directory_[key] == NO_BLOCK) {
+        directory_[key] = static_cast<uint32_t>(blocks_.size());
+        blocks_.emplace_back();
+    }
+    return blocks_[directory_[key]];
+}
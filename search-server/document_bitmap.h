@@ -0,0 +1,57 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Set of document ids split into blocks of 2^16 consecutive ids, as in a roaring bitmap. A block keeps
+// its ids in a sorted array while that is smaller than a bitmap of its range, so memory follows the
+// number of ids rather than the largest one, and dense ids still cost a bit each.
+class DocumentBitmap {
+public:
+    void Set(int document_id);
+    void Reset(int document_id);
+    bool Test(int document_id) const {
+        const size_t key = static_cast<size_t>(document_id) >> BLOCK_BITS;
+        return key < directory_.size() && directory_[key] != NO_BLOCK
+               && blocks_[directory_[key]].Test(static_cast<uint16_t>(document_id));
+    }
+
+    DocumentBitmap& operator|=(const DocumentBitmap& other);
+    // Clears every bit outside of [first_id, last_id]
+    void KeepRange(int first_id, int last_id);
+
+    size_t Count() const;
+    std::vector<int> GetDocumentIds() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    static constexpr int BLOCK_BITS = 16;
+    static constexpr size_t BLOCK_WORDS = (size_t{1} << BLOCK_BITS) / 64;
+    // above this many ids the array of a block would take more memory than its bitmap
+    static constexpr size_t MAX_ARRAY_SIZE = BLOCK_WORDS * sizeof(uint64_t) / sizeof(uint16_t);
+    static constexpr uint32_t NO_BLOCK = UINT32_MAX;
+
+    struct Block {
+        // sorted low bits of the ids while the block is an array, empty once it is a bitmap
+        std::vector<uint16_t> ids;
+        // BLOCK_WORDS words once the block is a bitmap
+        std::vector<uint64_t> bits;
+
+        bool Test(uint16_t low) const {
+            if (!bits.empty()) {
+                return bits[low / 64] >> (low % 64) & 1;
+            }
+            return std::binary_search(ids.begin(), ids.end(), low);
+        }
+        void Set(uint16_t low);
+        void Reset(uint16_t low);
+        void ConvertToBitmap();
+        size_t Count() const;
+    };
+
+    // position in blocks_ of the block of every 2^16 ids up to the largest block, NO_BLOCK if it has none
+    std::vector<uint32_t> directory_;
+    std::vector<Block> blocks_;
+
+    Block& GetOrAddBlock(size_t key);
+};
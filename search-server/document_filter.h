@@ -0,0 +1,14 @@
+#pragma once
+#include <limits>
+#include <set>
+#include "document.h"
+
+// Structured alternative to predicate lambdas: the server evaluates it on its indexes before scoring.
+// Bounds are inclusive; an empty status set accepts every status.
+struct DocumentFilter {
+    std::set<DocumentStatus> statuses;
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+    int min_id = 0;
+    int max_id = std::numeric_limits<int>::max();
+};
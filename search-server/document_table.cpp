@@ -0,0 +1,85 @@
+#include <utility>
+#include "document_table.h"
+#include "memory_usage.h"
+
+DocumentTable::DocumentTable(std::pmr::memory_resource* metadata_resource, std::pmr::memory_resource* forward_index_resource)
+    : slots_(metadata_resource)
+    , external_ids_(metadata_resource)
+    , ratings_(metadata_resource)
+    , statuses_(metadata_resource)
+    , lengths_(metadata_resource)
+    , live_(metadata_resource)
+    , term_ids_(forward_index_resource)
+    , word_frequencies_(forward_index_resource) {
+}
+
+size_t DocumentTable::Add(int document_id, int rating, DocumentStatus status, int length,
+                          std::pmr::vector<int> term_ids, std::pmr::vector<WordFrequency> word_frequencies) {
+    const size_t slot = external_ids_.size();
+    slots_.emplace(document_id, slot);
+    external_ids_.push_back(document_id);
+    ratings_.push_back(rating);
+    statuses_.push_back(status);
+    lengths_.push_back(length);
+    live_.push_back(1);
+    term_ids_.push_back(std::move(term_ids));
+    word_frequencies_.push_back(std::move(word_frequencies));
+    return slot;
+}
+
+bool DocumentTable::Remove(int document_id) {
+    const auto found = slots_.find(document_id);
+    if (found == slots_.end()) {
+        return false;
+    }
+    const size_t slot = found->second;
+    slots_.erase(found);
+    live_[slot] = 0;
+    term_ids_[slot] = std::pmr::vector<int>(term_ids_.get_allocator());
+    word_frequencies_[slot] = std::pmr::vector<WordFrequency>(word_frequencies_.get_allocator());
+    if (slots_.size() * 2 < external_ids_.size()) {
+        Compact();
+    }
+    return true;
+}
+
+void DocumentTable::Compact() {
+    size_t target = 0;
+    for (size_t slot = 0; slot < external_ids_.size(); ++slot) {
+        if (!live_[slot]) {
+            continue;
+        }
+        if (target != slot) {
+            external_ids_[target] = external_ids_[slot];
+            ratings_[target] = ratings_[slot];
+            statuses_[target] = statuses_[slot];
+            lengths_[target] = lengths_[slot];
+            live_[target] = 1;
+            // the allocators are equal, so the buffers change hands and the views into them stay valid
+            term_ids_[target] = std::move(term_ids_[slot]);
+            word_frequencies_[target] = std::move(word_frequencies_[slot]);
+            slots_[external_ids_[target]] = target;
+        }
+        ++target;
+    }
+    external_ids_.resize(target);
+    ratings_.resize(target);
+    statuses_.resize(target);
+    lengths_.resize(target);
+    live_.resize(target);
+    term_ids_.resize(target);
+    word_frequencies_.resize(target);
+}
+
+size_t DocumentTable::EstimateMetadataMemory() const {
+    return EstimateHashMapMemory(slots_) + GetVectorMemory(external_ids_) + GetVectorMemory(ratings_)
+           + GetVectorMemory(statuses_) + GetVectorMemory(lengths_) + GetVectorMemory(live_);
+}
+
+size_t DocumentTable::EstimateForwardIndexMemory() const {
+    size_t memory = GetVectorMemory(term_ids_) + GetVectorMemory(word_frequencies_);
+    for (size_t slot = 0; slot < external_ids_.size(); ++slot) {
+        memory += GetVectorMemory(term_ids_[slot]) + GetVectorMemory(word_frequencies_[slot]);
+    }
+    return memory;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+#include "word_frequencies.h"
+
+// Documents of the server in structure-of-arrays layout. Every document gets an internal slot in the
+// order it was added and an external id maps to its slot through a hash table, so reading the rating
+// or the status is one probe and one array index instead of a tree walk. A removed document leaves a
+// dead slot behind; once dead slots outnumber live ones the table is compacted, keeping the order.
+// The forward index is stored in the same slots, and its buffers never move while the document lives.
+class DocumentTable {
+public:
+    static constexpr size_t NO_SLOT = std::numeric_limits<size_t>::max();
+
+    // Live external ids in the order the documents were added
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        Iterator(const DocumentTable* table, size_t slot)
+            : table_(table)
+            , slot_(table->SkipDead(slot)) {
+        }
+        reference operator*() const {
+            return table_->external_ids_[slot_];
+        }
+        Iterator& operator++() {
+            slot_ = table_->SkipDead(slot_ + 1);
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const Iterator& other) const {
+            return slot_ == other.slot_;
+        }
+        bool operator!=(const Iterator& other) const {
+            return slot_ != other.slot_;
+        }
+
+    private:
+        const DocumentTable* table_;
+        size_t slot_;
+    };
+
+    // metadata columns take memory from the first resource, the forward index from the second
+    DocumentTable(std::pmr::memory_resource* metadata_resource, std::pmr::memory_resource* forward_index_resource);
+
+    // The vectors must come from the forward index resource, then they are moved without copying
+    size_t Add(int document_id, int rating, DocumentStatus status, int length,
+               std::pmr::vector<int> term_ids, std::pmr::vector<WordFrequency> word_frequencies);
+    // Returns false if there is no such document
+    bool Remove(int document_id);
+
+    // NO_SLOT if there is no such document
+    size_t Find(int document_id) const {
+        const auto found = slots_.find(document_id);
+        return found != slots_.end() ? found->second : NO_SLOT;
+    }
+    int GetRating(size_t slot) const {
+        return ratings_[slot];
+    }
+    DocumentStatus GetStatus(size_t slot) const {
+        return statuses_[slot];
+    }
+    // number of words the document was indexed with, stop words excluded
+    int GetLength(size_t slot) const {
+        return lengths_[slot];
+    }
+    // sorted term ids of the document
+    const std::pmr::vector<int>& GetTermIds(size_t slot) const {
+        return term_ids_[slot];
+    }
+    WordFrequencies GetWordFrequencies(size_t slot) const {
+        return {word_frequencies_[slot].data(), word_frequencies_[slot].size()};
+    }
+
+    size_t GetSize() const {
+        return slots_.size();
+    }
+    Iterator begin() const {
+        return {this, 0};
+    }
+    Iterator end() const {
+        return {this, external_ids_.size()};
+    }
+
+    // used when the tracking allocators are compiled out
+    size_t EstimateMetadataMemory() const;
+    size_t EstimateForwardIndexMemory() const;
+
+private:
+    std::pmr::unordered_map<int, size_t> slots_;
+    std::pmr::vector<int> external_ids_;
+    std::pmr::vector<int> ratings_;
+    std::pmr::vector<DocumentStatus> statuses_;
+    std::pmr::vector<int> lengths_;
+    std::pmr::vector<uint8_t> live_;
+    std::pmr::vector<std::pmr::vector<int>> term_ids_;
+    std::pmr::vector<std::pmr::vector<WordFrequency>> word_frequencies_;
+
+    size_t SkipDead(size_t slot) const {
+        while (slot < live_.size() && !live_[slot]) {
+            ++slot;
+        }
+        return slot;
+    }
+    void Compact();
+};
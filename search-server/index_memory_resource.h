@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+// Building with -DSEARCH_SERVER_DISABLE_MEMORY_TRACKING removes the byte counting below;
+// SearchServer::GetMemoryUsage() then estimates the pooled parts of the index from their element counts.
+
+// Forwards to another resource and counts the bytes held through it, along with the peak of that number.
+// Counters are atomic because the parallel RemoveDocument releases memory from several threads.
+class TrackingMemoryResource : public std::pmr::memory_resource {
+public:
+    explicit TrackingMemoryResource(std::pmr::memory_resource* upstream)
+        : upstream_(upstream) {
+    }
+
+    size_t GetBytes() const {
+        return bytes_.load(std::memory_order_relaxed);
+    }
+    size_t GetPeakBytes() const {
+        return peak_bytes_.load(std::memory_order_relaxed);
+    }
+    void ResetPeak() {
+        peak_bytes_.store(GetBytes(), std::memory_order_relaxed);
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* const pointer = upstream_->allocate(bytes, alignment);
+#ifndef SEARCH_SERVER_DISABLE_MEMORY_TRACKING
+        const size_t held = bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+        while (held > peak && !peak_bytes_.compare_exchange_weak(peak, held, std::memory_order_relaxed)) {
+        }
+#endif
+        return pointer;
+    }
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        upstream_->deallocate(pointer, bytes, alignment);
+#ifndef SEARCH_SERVER_DISABLE_MEMORY_TRACKING
+        bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+#endif
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* const upstream_;
+    std::atomic<size_t> bytes_{0};
+    std::atomic<size_t> peak_bytes_{0};
+};
+
+// Pools of equally sized blocks for the long-lived nodes of the index. Once the owner starts tearing
+// the index down node deallocations are skipped: the pools hand all of their chunks back at once
+// right after, so destroying a large index does not pay a deallocation per node.
+class IndexMemoryResource : public std::pmr::memory_resource {
+public:
+    void BeginTeardown() {
+        tearing_down_ = true;
+    }
+
+    // bytes the pools took from the heap, their unused slack included
+    size_t GetReservedBytes() const {
+        return heap_.GetBytes();
+    }
+    size_t GetPeakReservedBytes() const {
+        return heap_.GetPeakBytes();
+    }
+    void ResetPeak() {
+        heap_.ResetPeak();
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return pool_.allocate(bytes, alignment);
+    }
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        if (!tearing_down_) {
+            pool_.deallocate(pointer, bytes, alignment);
+        }
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    TrackingMemoryResource heap_{std::pmr::new_delete_resource()};
+    // synchronized because the parallel RemoveDocument erases postings from several threads
+    std::pmr::synchronized_pool_resource pool_{&heap_};
+    bool tearing_down_ = false;
+};
@@ -0,0 +1,19 @@
+#include "memory_usage.h"
+
+using namespace std::string_literals;
+
+size_t MemoryUsage::GetTotal() const {
+    return term_dictionary + postings + forward_index + document_metadata + stop_words + query_cache;
+}
+
+std::ostream& operator<<(std::ostream& out, const MemoryUsage& usage) {
+    out << "term dictionary: "s << usage.term_dictionary << "\n"s
+        << "postings: "s << usage.postings << "\n"s
+        << "forward index: "s << usage.forward_index << "\n"s
+        << "document metadata: "s << usage.document_metadata << "\n"s
+        << "stop words: "s << usage.stop_words << "\n"s
+        << "query cache: "s << usage.query_cache << "\n"s
+        << "total: "s << usage.GetTotal() << (usage.exact ? ""s : " (estimated)"s) << "\n"s
+        << "index pools: "s << usage.index_pool_reserved << " reserved, "s << usage.index_pool_peak << " peak\n"s;
+    return out;
+}
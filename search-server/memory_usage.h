@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <iostream>
+
+// Bytes held by each part of a SearchServer. The parts kept in the index pools are counted exactly by
+// tracking allocators, unless the build disables them; then they are estimated from element counts.
+struct MemoryUsage {
+    // terms, term ids and the term lookup table
+    size_t term_dictionary = 0;
+    // inverted index: word -> documents with term frequencies
+    size_t postings = 0;
+    // per-document term ids and word frequencies
+    size_t forward_index = 0;
+    // ratings, statuses, id list, status bitmaps and the rating index
+    size_t document_metadata = 0;
+    size_t stop_words = 0;
+    size_t query_cache = 0;
+    // bytes the index pools took from the heap, slack included, and their peak since the last reset
+    size_t index_pool_reserved = 0;
+    size_t index_pool_peak = 0;
+    bool exact = false;
+
+    size_t GetTotal() const;
+};
+
+std::ostream& operator<<(std::ostream& out, const MemoryUsage& usage);
+
+// Estimates used when the tracking allocators are compiled out. The sizes are those of the nodes the
+// standard containers allocate: a tree node carries a color and three links, a hash node a link and
+// the cached hash.
+const size_t TREE_NODE_OVERHEAD = 4 * sizeof(void*);
+const size_t HASH_NODE_OVERHEAD = 2 * sizeof(void*);
+
+inline size_t AlignNodeSize(size_t size) {
+    return (size + alignof(void*) - 1) / alignof(void*) * alignof(void*);
+}
+
+template <typename Tree>
+size_t EstimateTreeMemory(const Tree& tree) {
+    return tree.size() * AlignNodeSize(TREE_NODE_OVERHEAD + sizeof(typename Tree::value_type));
+}
+
+template <typename HashMap>
+size_t EstimateHashMapMemory(const HashMap& hash_map) {
+    return hash_map.size() * AlignNodeSize(HASH_NODE_OVERHEAD + sizeof(typename HashMap::value_type))
+           + hash_map.bucket_count() * sizeof(void*);
+}
+
+template <typename Vector>
+size_t GetVectorMemory(const Vector& vector) {
+    return vector.capacity() * sizeof(typename Vector::value_type);
+}
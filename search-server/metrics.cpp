@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include "metrics.h"
+
+using namespace std::string_view_literals;
+
+namespace {
+std::array<LatencyHistogram, SEARCH_STAGE_COUNT> stage_histograms;
+std::array<std::atomic<uint64_t>, PLANNER_DECISION_COUNT> planner_decisions = {};
+}
+
+std::string_view GetStageName(SearchStage stage) {
+    switch (stage) {
+        case SearchStage::TOKENIZE: return "tokenize"sv;
+        case SearchStage::PARSE_QUERY: return "parse_query"sv;
+        case SearchStage::SCORING: return "scoring"sv;
+        case SearchStage::MINUS_WORDS: return "minus_words"sv;
+        case SearchStage::TOP_K: return "top_k"sv;
+        case SearchStage::MATCH_DOCUMENT: return "match_document"sv;
+    }
+    return "unknown"sv;
+}
+
+std::string_view GetPlannerDecisionName(PlannerDecision decision) {
+    switch (decision) {
+        case PlannerDecision::TERM_AT_A_TIME: return "term_at_a_time"sv;
+        case PlannerDecision::DOCUMENT_AT_A_TIME: return "document_at_a_time"sv;
+        case PlannerDecision::SEQUENTIAL: return "sequential"sv;
+        case PlannerDecision::PARALLEL: return "parallel"sv;
+        case PlannerDecision::MINUS_WORDS_FIRST: return "minus_words_first"sv;
+        case PlannerDecision::DENSE_ACCUMULATOR: return "dense_accumulator"sv;
+    }
+    return "unknown"sv;
+}
+
+void RecordPlannerDecision(PlannerDecision decision) {
+    planner_decisions[static_cast<size_t>(decision)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Record(uint64_t value_ns) {
+    buckets_[GetBucketIndex(value_ns)].fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(value_ns, std::memory_order_relaxed);
+    uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+    while (value_ns > max_ns && !max_ns_.compare_exchange_weak(max_ns, value_ns, std::memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::GetSnapshot() const {
+    HistogramSnapshot snapshot;
+    for (const auto& bucket : buckets_) {
+        snapshot.count += bucket.load(std::memory_order_relaxed);
+    }
+    if (snapshot.count == 0) {
+        return snapshot;
+    }
+    snapshot.max_ns = max_ns_.load(std::memory_order_relaxed);
+    snapshot.mean_ns = static_cast<double>(sum_ns_.load(std::memory_order_relaxed)) / snapshot.count;
+    snapshot.p50_ns = GetValueAtPercentile(50.0);
+    snapshot.p99_ns = GetValueAtPercentile(99.0);
+    snapshot.p999_ns = GetValueAtPercentile(99.9);
+    return snapshot;
+}
+
+uint64_t LatencyHistogram::GetValueAtPercentile(double percentile) const {
+    std::array<uint64_t, BUCKET_COUNT> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(GetBucketUpperBound(i), max_ns_.load(std::memory_order_relaxed));
+        }
+    }
+    return max_ns_.load(std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value_ns) {
+    if (value_ns < SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value_ns);
+    }
+    const int highest_bit = 63 - __builtin_clzll(value_ns);
+    const int shift = highest_bit - (SUB_BUCKET_BITS - 1);
+    return static_cast<size_t>(shift * SUB_BUCKET_HALF + (value_ns >> shift));
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const uint64_t shift = index / SUB_BUCKET_HALF - 1;
+    const uint64_t sub_bucket = index - shift * SUB_BUCKET_HALF;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+LatencyHistogram& GetStageHistogram(SearchStage stage) {
+    return stage_histograms[static_cast<size_t>(stage)];
+}
+
+MetricsSnapshot GetMetrics() {
+    MetricsSnapshot metrics;
+    for (size_t i = 0; i < SEARCH_STAGE_COUNT; ++i) {
+        metrics.stages[i] = stage_histograms[i].GetSnapshot();
+    }
+    for (size_t i = 0; i < PLANNER_DECISION_COUNT; ++i) {
+        metrics.planner_decisions[i] = planner_decisions[i].load(std::memory_order_relaxed);
+    }
+    return metrics;
+}
+
+void ResetMetrics() {
+    for (auto& histogram : stage_histograms) {
+        histogram.Reset();
+    }
+    for (auto& counter : planner_decisions) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+void PrintMetrics(std::ostream& out, const MetricsSnapshot& metrics) {
+    for (size_t i = 0; i < SEARCH_STAGE_COUNT; ++i) {
+        const HistogramSnapshot& stage = metrics.stages[i];
+        out << std::left << std::setw(16) << GetStageName(static_cast<SearchStage>(i))
+            << " count="sv << stage.count
+            << " mean="sv << static_cast<uint64_t>(stage.mean_ns) << "ns"sv
+            << " p50="sv << stage.p50_ns << "ns"sv
+            << " p99="sv << stage.p99_ns << "ns"sv
+            << " p999="sv << stage.p999_ns << "ns"sv
+            << " max="sv << stage.max_ns << "ns"sv << std::endl;
+    }
+    out << "planner"sv;
+    for (size_t i = 0; i < PLANNER_DECISION_COUNT; ++i) {
+        out << ' ' << GetPlannerDecisionName(static_cast<PlannerDecision>(i)) << '=' << metrics.planner_decisions[i];
+    }
+    out << std::endl;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+// Building with -DSEARCH_SERVER_DISABLE_METRICS turns every STAGE_TIMER into a no-op.
+#define METRICS_CONCAT_INTERNAL(X, Y) X##Y
+#define METRICS_CONCAT(X, Y) METRICS_CONCAT_INTERNAL(X, Y)
+#define UNIQUE_VAR_NAME_STAGE METRICS_CONCAT(stageTimer, __LINE__)
+
+#ifdef SEARCH_SERVER_DISABLE_METRICS
+#define STAGE_TIMER(stage)
+#define PLANNER_DECISION(decision)
+#else
+#define STAGE_TIMER(stage) StageTimer UNIQUE_VAR_NAME_STAGE(stage)
+#define PLANNER_DECISION(decision) RecordPlannerDecision(decision)
+#endif
+
+enum class SearchStage {
+    TOKENIZE,
+    PARSE_QUERY,
+    SCORING,
+    MINUS_WORDS,
+    TOP_K,
+    MATCH_DOCUMENT,
+};
+
+const size_t SEARCH_STAGE_COUNT = static_cast<size_t>(SearchStage::MATCH_DOCUMENT) + 1;
+
+std::string_view GetStageName(SearchStage stage);
+
+// Choices made by the query planner, counted per executed query
+enum class PlannerDecision {
+    TERM_AT_A_TIME,
+    DOCUMENT_AT_A_TIME,
+    SEQUENTIAL,
+    PARALLEL,
+    MINUS_WORDS_FIRST,
+    DENSE_ACCUMULATOR,
+};
+
+const size_t PLANNER_DECISION_COUNT = static_cast<size_t>(PlannerDecision::DENSE_ACCUMULATOR) + 1;
+
+std::string_view GetPlannerDecisionName(PlannerDecision decision);
+void RecordPlannerDecision(PlannerDecision decision);
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t max_ns = 0;
+    double mean_ns = 0.0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+};
+
+// Log-linear (HDR-style) histogram of nanosecond values: 64 linear sub-buckets per power of two,
+// so every recorded value is reported with less than 1.6% relative error.
+class LatencyHistogram {
+public:
+    void Record(uint64_t value_ns);
+    HistogramSnapshot GetSnapshot() const;
+    uint64_t GetValueAtPercentile(double percentile) const;
+    void Reset();
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 7;
+    static constexpr uint64_t SUB_BUCKET_COUNT = uint64_t(1) << SUB_BUCKET_BITS;
+    static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_ = {};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+
+    static size_t GetBucketIndex(uint64_t value_ns);
+    static uint64_t GetBucketUpperBound(size_t index);
+};
+
+struct MetricsSnapshot {
+    std::array<HistogramSnapshot, SEARCH_STAGE_COUNT> stages;
+    std::array<uint64_t, PLANNER_DECISION_COUNT> planner_decisions = {};
+};
+
+LatencyHistogram& GetStageHistogram(SearchStage stage);
+MetricsSnapshot GetMetrics();
+void ResetMetrics();
+void PrintMetrics(std::ostream& out, const MetricsSnapshot& metrics);
+
+class StageTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StageTimer(SearchStage stage)
+        : histogram_(GetStageHistogram(stage)) {
+    }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    ~StageTimer() {
+        const auto duration = Clock::now() - start_time_;
+        histogram_.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+    }
+
+private:
+    LatencyHistogram& histogram_;
+    const Clock::time_point start_time_ = Clock::now();
+};
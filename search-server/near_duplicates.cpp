@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include "near_duplicates.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+}  // namespace
+
+double ComputeJaccardSimilarity(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+    if (lhs.empty() && rhs.empty()) {
+        return 0.0;
+    }
+    size_t intersection = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (lhs_it->first < rhs_it->first) {
+            ++lhs_it;
+        } else if (rhs_it->first < lhs_it->first) {
+            ++rhs_it;
+        } else {
+            ++intersection;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return static_cast<double>(intersection) / (lhs.size() + rhs.size() - intersection);
+}
+
+std::vector<uint64_t> ComputeMinHashSignature(const WordFrequencies& word_frequencies) {
+    std::vector<uint64_t> signature(MINHASH_SIGNATURE_SIZE, std::numeric_limits<uint64_t>::max());
+    for (const auto& [word, _] : word_frequencies) {
+        // i-th hash function is h1 + i * h2 (Kirsch-Mitzenmacher), remixed to break linearity
+        const uint64_t first_hash = Mix(std::hash<std::string_view>{}(word));
+        const uint64_t second_hash = Mix(first_hash ^ 0x9E3779B97F4A7C15ull) | 1;
+        for (int i = 0; i < MINHASH_SIGNATURE_SIZE; ++i) {
+            signature[i] = std::min(signature[i], Mix(first_hash + i * second_hash));
+        }
+    }
+    return signature;
+}
+
+NearDuplicateIndex::NearDuplicateIndex(double threshold)
+    : threshold_(threshold) {
+    if (!(threshold > 0.0 && threshold <= 1.0)) {
+        throw std::invalid_argument("near duplicate threshold must be in (0, 1]"s);
+    }
+    bands_ = MINHASH_SIGNATURE_SIZE;
+    rows_ = 1;
+    double best_threshold = 0.0;
+    for (int rows = 1; rows <= MINHASH_SIGNATURE_SIZE; ++rows) {
+        const int bands = MINHASH_SIGNATURE_SIZE / rows;
+        const double lsh_threshold = std::pow(1.0 / bands, 1.0 / rows);
+        if (lsh_threshold <= threshold && lsh_threshold > best_threshold) {
+            best_threshold = lsh_threshold;
+            bands_ = bands;
+            rows_ = rows;
+        }
+    }
+    band_buckets_.resize(bands_);
+}
+
+std::vector<NearDuplicatePair> NearDuplicateIndex::AddDocument(const SearchServer& search_server, int document_id) {
+    const WordFrequencies words = search_server.GetWordFrequencies(document_id);
+    if (words.empty()) {
+        return {};
+    }
+    Signature signature = ComputeMinHashSignature(words);
+    const uint64_t key = ComputeSignatureKey(signature);
+
+    std::vector<int> candidates;
+    if (const auto group = signature_groups_.find(key); group != signature_groups_.end()) {
+        candidates = group->second;
+    }
+    for (int band = 0; band < bands_; ++band) {
+        const auto found = band_buckets_[band].find(ComputeBandHash(signature, band));
+        if (found == band_buckets_[band].end()) continue;
+        // a window of the bucket starting at a point that differs from band to band
+        const std::vector<uint64_t>& keys = found->second;
+        const size_t start = Mix(key + band) % keys.size();
+        for (size_t i = 0; i < std::min(keys.size(), NEAR_DUPLICATE_BUCKET_WINDOW); ++i) {
+            const uint64_t candidate_key = keys[(start + i) % keys.size()];
+            if (candidate_key == key) continue;
+            const std::vector<int>& group = signature_groups_.at(candidate_key);
+            candidates.insert(candidates.end(), group.begin(), group.end());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<NearDuplicatePair> result;
+    for (const int candidate_id : candidates) {
+        if (candidate_id == document_id) continue;
+        const double similarity = ComputeJaccardSimilarity(search_server.GetWordFrequencies(candidate_id), words);
+        if (similarity >= threshold_) {
+            result.push_back({candidate_id, document_id, similarity});
+        }
+    }
+
+    InsertSignature(document_id, std::move(signature));
+    return result;
+}
+
+void NearDuplicateIndex::RemoveDocument(int document_id) {
+    const auto found = signatures_.find(document_id);
+    if (found == signatures_.end()) return;
+    const uint64_t key = ComputeSignatureKey(found->second);
+    auto group = signature_groups_.find(key);
+    group->second.erase(std::remove(group->second.begin(), group->second.end(), document_id), group->second.end());
+    if (group->second.empty()) {
+        signature_groups_.erase(group);
+        for (int band = 0; band < bands_; ++band) {
+            auto bucket = band_buckets_[band].find(ComputeBandHash(found->second, band));
+            if (bucket == band_buckets_[band].end()) continue;
+            auto& keys = bucket->second;
+            keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+            if (keys.empty()) {
+                band_buckets_[band].erase(bucket);
+            }
+        }
+    }
+    signatures_.erase(found);
+}
+
+std::vector<NearDuplicatePair> NearDuplicateIndex::FindAllPairs(const SearchServer& search_server) const {
+    std::vector<std::pair<int, int>> candidates;
+    const auto add_candidates = [this, &candidates](uint64_t lhs_key, uint64_t rhs_key) {
+        for (const int lhs_id : signature_groups_.at(lhs_key)) {
+            for (const int rhs_id : signature_groups_.at(rhs_key)) {
+                candidates.emplace_back(std::min(lhs_id, rhs_id), std::max(lhs_id, rhs_id));
+            }
+        }
+    };
+    for (const auto& [_, ids] : signature_groups_) {
+        for (size_t i = 0; i < ids.size(); ++i) {
+            for (size_t j = i + 1; j < ids.size(); ++j) {
+                candidates.emplace_back(std::min(ids[i], ids[j]), std::max(ids[i], ids[j]));
+            }
+        }
+    }
+    std::vector<std::pair<uint64_t, uint64_t>> order;
+    for (int band = 0; band < bands_; ++band) {
+        for (const auto& [_, keys] : band_buckets_[band]) {
+            // groups ordered by a hash seeded with the band, so every band pairs a group with other neighbours
+            order.clear();
+            for (const uint64_t key : keys) {
+                order.emplace_back(Mix(key + band), key);
+            }
+            if (keys.size() > NEAR_DUPLICATE_BUCKET_WINDOW + 1) {
+                std::sort(order.begin(), order.end());
+            }
+            for (size_t i = 0; i < order.size(); ++i) {
+                const size_t window_end = std::min(order.size(), i + 1 + NEAR_DUPLICATE_BUCKET_WINDOW);
+                for (size_t j = i + 1; j < window_end; ++j) {
+                    add_candidates(order[i].second, order[j].second);
+                }
+            }
+        }
+    }
+    std::sort(std::execution::par, candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<NearDuplicatePair> pairs(candidates.size());
+    std::transform(std::execution::par,
+                   candidates.begin(),
+                   candidates.end(),
+                   pairs.begin(),
+                   [&search_server](const std::pair<int, int>& candidate) {
+                        return NearDuplicatePair{candidate.first, candidate.second,
+                                                 ComputeJaccardSimilarity(search_server.GetWordFrequencies(candidate.first),
+                                                                          search_server.GetWordFrequencies(candidate.second))};
+                   });
+    pairs.erase(std::remove_if(pairs.begin(), pairs.end(), [this](const NearDuplicatePair& pair) {
+        return pair.similarity < threshold_;
+    }), pairs.end());
+    return pairs;
+}
+
+int NearDuplicateIndex::GetBandCount() const {
+    return bands_;
+}
+
+int NearDuplicateIndex::GetRowsPerBand() const {
+    return rows_;
+}
+
+uint64_t NearDuplicateIndex::ComputeBandHash(const Signature& signature, int band) const {
+    uint64_t hash = Mix(static_cast<uint64_t>(band) + 1);
+    for (int row = 0; row < rows_; ++row) {
+        hash = Mix(hash ^ signature[band * rows_ + row]);
+    }
+    return hash;
+}
+
+uint64_t NearDuplicateIndex::ComputeSignatureKey(const Signature& signature) {
+    uint64_t key = Mix(MINHASH_SIGNATURE_SIZE);
+    for (const uint64_t value : signature) {
+        key = Mix(key ^ value);
+    }
+    return key;
+}
+
+void NearDuplicateIndex::InsertSignature(int document_id, Signature signature) {
+    // a group enters the band buckets once, with its first document
+    const uint64_t key = ComputeSignatureKey(signature);
+    std::vector<int>& group = signature_groups_[key];
+    if (group.empty()) {
+        for (int band = 0; band < bands_; ++band) {
+            band_buckets_[band][ComputeBandHash(signature, band)].push_back(key);
+        }
+    }
+    group.push_back(document_id);
+    signatures_[document_id] = std::move(signature);
+}
+
+std::vector<NearDuplicatePair> FindNearDuplicates(const SearchServer& search_server, double threshold) {
+    NearDuplicateIndex index(threshold);
+    const std::vector<int> all_ids(search_server.begin(), search_server.end());
+    const std::vector<WordFrequencies> all_words = search_server.GetWordFrequencies(all_ids);
+    std::vector<int> document_ids;
+    std::vector<WordFrequencies> document_words;
+    for (size_t i = 0; i < all_ids.size(); ++i) {
+        if (!all_words[i].empty()) {
+            document_ids.push_back(all_ids[i]);
+            document_words.push_back(all_words[i]);
+        }
+    }
+    std::vector<std::vector<uint64_t>> signatures(document_ids.size());
+    std::transform(std::execution::par,
+                   document_words.begin(),
+                   document_words.end(),
+                   signatures.begin(),
+                   [](const WordFrequencies& words) {
+                        return ComputeMinHashSignature(words);
+                   });
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        index.InsertSignature(document_ids[i], std::move(signatures[i]));
+    }
+    return index.FindAllPairs(search_server);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "search_server.h"
+
+const int MINHASH_SIGNATURE_SIZE = 128;
+// in an LSH bucket holding more distinct signatures, each one is paired only with this many others, in
+// an order that differs from band to band, so a low threshold (one row per band) does not make candidate
+// generation quadratic; documents with identical signatures are always paired
+const size_t NEAR_DUPLICATE_BUCKET_WINDOW = 64;
+
+struct NearDuplicatePair {
+    int first_id;
+    int second_id;
+    double similarity;
+};
+
+double ComputeJaccardSimilarity(const WordFrequencies& lhs, const WordFrequencies& rhs);
+
+// MinHash signatures split into LSH bands. The band layout is chosen so that the LSH threshold lies
+// slightly below the requested Jaccard threshold; every candidate is verified with the exact similarity,
+// so results contain no false positives.
+class NearDuplicateIndex {
+public:
+    explicit NearDuplicateIndex(double threshold);
+
+    // Indexes the document and returns already indexed documents similar to it
+    std::vector<NearDuplicatePair> AddDocument(const SearchServer& search_server, int document_id);
+    void RemoveDocument(int document_id);
+
+    std::vector<NearDuplicatePair> FindAllPairs(const SearchServer& search_server) const;
+
+    int GetBandCount() const;
+    int GetRowsPerBand() const;
+
+private:
+    using Signature = std::vector<uint64_t>;
+
+    const double threshold_;
+    int bands_;
+    int rows_;
+    std::unordered_map<int, Signature> signatures_;
+    // key of a signature -> documents with that signature, e.g. exact duplicates
+    std::unordered_map<uint64_t, std::vector<int>> signature_groups_;
+    // band hash -> keys of the signature groups in the bucket
+    std::vector<std::unordered_map<uint64_t, std::vector<uint64_t>>> band_buckets_;
+
+    static uint64_t ComputeSignatureKey(const Signature& signature);
+    uint64_t ComputeBandHash(const Signature& signature, int band) const;
+    void InsertSignature(int document_id, Signature signature);
+
+    friend std::vector<NearDuplicatePair> FindNearDuplicates(const SearchServer& search_server, double threshold);
+};
+
+std::vector<uint64_t> ComputeMinHashSignature(const WordFrequencies& word_frequencies);
+
+std::vector<NearDuplicatePair> FindNearDuplicates(const SearchServer& search_server, double threshold);
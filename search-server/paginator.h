@@ -1,4 +1,8 @@
 #pragma once
+#include <deque>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 #include <cmath>
 #include <cassert>
@@ -72,3 +76,96 @@ template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
 }
+
+// Pages fetched on demand instead of slicing a finished vector. The page source is called with the last
+// fetched page, or nullptr for the first one, and returns the next page; an empty page ends the
+// sequence. Fetched pages are kept, so returning to a page is free and moving forward fetches only the
+// pages in between.
+template <typename Value, typename PageSource>
+class LazyPaginator {
+public:
+    using Page = std::vector<Value>;
+
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Page;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Page*;
+        using reference = const Page&;
+
+        Iterator(LazyPaginator* paginator, size_t index)
+            : paginator_(paginator)
+            , index_(index) {
+        }
+        reference operator*() const {
+            return paginator_->GetPage(index_);
+        }
+        pointer operator->() const {
+            return &paginator_->GetPage(index_);
+        }
+        Iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+        // an iterator reaches the end once its page does not exist, which may take a fetch to find out
+        bool operator==(const Iterator& other) const {
+            return IsEnd() == other.IsEnd() && (IsEnd() || index_ == other.index_);
+        }
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        LazyPaginator* paginator_;
+        size_t index_;
+
+        bool IsEnd() const {
+            return paginator_ == nullptr || !paginator_->HasPage(index_);
+        }
+    };
+
+    explicit LazyPaginator(PageSource page_source)
+        : page_source_(std::move(page_source)) {
+    }
+
+    Iterator begin() {
+        return {this, 0};
+    }
+    Iterator end() {
+        return {nullptr, 0};
+    }
+
+    // Fetches pages up to the given one; false if the results end before it
+    bool HasPage(size_t index) {
+        while (pages_.size() <= index && !exhausted_) {
+            Page page = page_source_(pages_.empty() ? nullptr : &pages_.back());
+            if (page.empty()) {
+                exhausted_ = true;
+            } else {
+                pages_.push_back(std::move(page));
+            }
+        }
+        return index < pages_.size();
+    }
+    // Pages are numbered from zero; throws std::out_of_range past the last page
+    const Page& GetPage(size_t index) {
+        if (!HasPage(index)) {
+            throw std::out_of_range("no such page");
+        }
+        return pages_[index];
+    }
+    size_t GetFetchedPageCount() const {
+        return pages_.size();
+    }
+
+private:
+    PageSource page_source_;
+    std::deque<Page> pages_;
+    bool exhausted_ = false;
+};
+
+template <typename Value, typename PageSource>
+auto PaginateLazily(PageSource page_source) {
+    return LazyPaginator<Value, PageSource>(std::move(page_source));
+}
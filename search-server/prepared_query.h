@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "query_plan.h"
+
+class SearchServer;
+
+// Query parsed and resolved against a SearchServer once, for queries executed many times.
+// The resolution is tied to the index state: once documents are added or removed the server
+// resolves the stored words again on every execution, so results stay exact but the call gets slower
+// until the query is prepared again.
+class PreparedQuery {
+public:
+    const std::vector<std::string>& GetPlusWords() const {
+        return plus_words_;
+    }
+    const std::vector<std::string>& GetMinusWords() const {
+        return minus_words_;
+    }
+
+private:
+    friend class SearchServer;
+
+    std::vector<std::string> plus_words_;
+    std::vector<std::string> minus_words_;
+    // id of the server that resolved the query; ids are never reused, unlike addresses of destroyed servers
+    uint64_t server_id_ = 0;
+    uint64_t epoch_ = 0;
+    std::vector<int> plus_term_ids_;
+    std::vector<int> minus_term_ids_;
+    QueryPlan plan_;
+    QueryPlan parallel_plan_;
+};
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <memory>
+#include "query_arena.h"
+
+namespace {
+
+struct ThreadBlock {
+    std::unique_ptr<std::byte[]> data;
+    size_t size = 0;
+    bool in_use = false;
+};
+
+thread_local ThreadBlock thread_block;
+
+}  // namespace
+
+QueryArena::QueryArena() {
+    if (thread_block.in_use) {
+        resource_.emplace(QUERY_ARENA_INITIAL_BLOCK_SIZE, &upstream_);
+        return;
+    }
+    if (!thread_block.data) {
+        thread_block.data = std::make_unique<std::byte[]>(QUERY_ARENA_INITIAL_BLOCK_SIZE);
+        thread_block.size = QUERY_ARENA_INITIAL_BLOCK_SIZE;
+    }
+    owns_block_ = true;
+    thread_block.in_use = true;
+    resource_.emplace(thread_block.data.get(), thread_block.size, &upstream_);
+}
+
+QueryArena::~QueryArena() {
+    resource_.reset();
+    if (!owns_block_) {
+        return;
+    }
+    thread_block.in_use = false;
+    // the next query of the thread is likely to need as much, so the block grows to what this one used
+    const size_t used = thread_block.size + upstream_.GetAllocatedBytes();
+    if (used > thread_block.size && thread_block.size < QUERY_ARENA_MAX_BLOCK_SIZE) {
+        const size_t size = std::min(std::max(used, thread_block.size * 2), QUERY_ARENA_MAX_BLOCK_SIZE);
+        thread_block.data = std::make_unique<std::byte[]>(size);
+        thread_block.size = size;
+    }
+}
+
+void* QueryArena::CountingResource::do_allocate(size_t bytes, size_t alignment) {
+    allocated_bytes_ += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void QueryArena::CountingResource::do_deallocate(void* pointer, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+bool QueryArena::CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
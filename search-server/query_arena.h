@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+
+// the block every thread starts with and the largest one it keeps between queries
+const size_t QUERY_ARENA_INITIAL_BLOCK_SIZE = 64 * 1024;
+const size_t QUERY_ARENA_MAX_BLOCK_SIZE = 8 * 1024 * 1024;
+
+// Scratch memory of a single query: parsed words, the plan, the relevance map and the candidate list.
+// Allocations are carved from a block owned by the calling thread and reused by every query it runs,
+// so in steady state a query does not touch the global heap. A query that outgrows the block takes
+// the rest from the heap, and the block is enlarged for the next query of the thread.
+// An arena created while another one is alive on the same thread (a nested parallel algorithm may
+// run a second query on a waiting worker) gets no block and allocates from the heap.
+class QueryArena {
+public:
+    QueryArena();
+    ~QueryArena();
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    std::pmr::memory_resource* GetResource() {
+        return &*resource_;
+    }
+    // bytes requested from the global heap because the thread block was too small or busy
+    size_t GetOverflowBytes() const {
+        return upstream_.GetAllocatedBytes();
+    }
+
+private:
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        size_t GetAllocatedBytes() const {
+            return allocated_bytes_;
+        }
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        size_t allocated_bytes_ = 0;
+    };
+
+    bool owns_block_ = false;
+    CountingResource upstream_;
+    std::optional<std::pmr::monotonic_buffer_resource> resource_;
+};
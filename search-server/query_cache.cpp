@@ -0,0 +1,90 @@
+#include <functional>
+#include <stdexcept>
+#include "query_cache.h"
+
+using namespace std::string_literals;
+
+QueryCache::QueryCache(size_t max_memory_bytes, size_t shard_count)
+    : max_memory_bytes_(max_memory_bytes)
+    , shard_memory_limit_(shard_count > 0 ? max_memory_bytes / shard_count : 0)
+    , shards_(shard_count) {
+    if (shard_count == 0) throw std::invalid_argument("query cache must have at least one shard"s);
+}
+
+std::optional<std::vector<Document>> QueryCache::Get(const std::string& key, uint64_t epoch) {
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.m);
+    const auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        ++shard.misses;
+        return std::nullopt;
+    }
+    if (found->second->epoch != epoch) {
+        EraseEntry(shard, found->second);
+        ++shard.misses;
+        return std::nullopt;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    ++shard.hits;
+    return found->second->documents;
+}
+
+void QueryCache::Put(const std::string& key, uint64_t epoch, const std::vector<Document>& documents) {
+    const size_t memory_usage = ComputeEntryMemory(key, documents);
+    if (memory_usage > shard_memory_limit_) return;
+
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.m);
+    if (const auto found = shard.index.find(key); found != shard.index.end()) {
+        EraseEntry(shard, found->second);
+    }
+    while (!shard.lru.empty() && shard.memory_usage + memory_usage > shard_memory_limit_) {
+        EraseEntry(shard, std::prev(shard.lru.end()));
+        ++shard.evictions;
+    }
+    shard.lru.push_front({key, epoch, documents, memory_usage});
+    shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+    shard.memory_usage += memory_usage;
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.m);
+        shard.index.clear();
+        shard.lru.clear();
+        shard.memory_usage = 0;
+    }
+}
+
+QueryCacheStats QueryCache::GetStats() const {
+    QueryCacheStats stats;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.m);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.entries += shard.lru.size();
+        stats.memory_usage += shard.memory_usage;
+    }
+    return stats;
+}
+
+size_t QueryCache::GetMaxMemory() const {
+    return max_memory_bytes_;
+}
+
+QueryCache::Shard& QueryCache::GetShard(const std::string& key) {
+    return shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+size_t QueryCache::ComputeEntryMemory(const std::string& key, const std::vector<Document>& documents) {
+    // list node + hash table node + key bytes + result payload
+    const size_t node_overhead = sizeof(Entry) + 2 * sizeof(void*) + sizeof(std::string_view) + 3 * sizeof(void*);
+    return node_overhead + key.capacity() + documents.size() * sizeof(Document);
+}
+
+void QueryCache::EraseEntry(Shard& shard, std::list<Entry>::iterator it) {
+    shard.memory_usage -= it->memory_usage;
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
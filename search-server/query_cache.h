@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t memory_usage = 0;
+};
+
+class QueryCache {
+public:
+    explicit QueryCache(size_t max_memory_bytes, size_t shard_count = 16);
+
+    std::optional<std::vector<Document>> Get(const std::string& key, uint64_t epoch);
+    void Put(const std::string& key, uint64_t epoch, const std::vector<Document>& documents);
+    void Clear();
+
+    QueryCacheStats GetStats() const;
+    size_t GetMaxMemory() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t epoch;
+        std::vector<Document> documents;
+        size_t memory_usage;
+    };
+
+    struct Shard {
+        mutable std::mutex m;
+        std::list<Entry> lru;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        size_t memory_usage = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    const size_t max_memory_bytes_;
+    const size_t shard_memory_limit_;
+    std::vector<Shard> shards_;
+
+    Shard& GetShard(const std::string& key);
+    static size_t ComputeEntryMemory(const std::string& key, const std::vector<Document>& documents);
+    static void EraseEntry(Shard& shard, std::list<Entry>::iterator it);
+};
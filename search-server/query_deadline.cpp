@@ -0,0 +1,20 @@
+#include "query_deadline.h"
+
+namespace {
+
+thread_local QueryBudget* active_budget = nullptr;
+
+}  // namespace
+
+QueryBudget* GetActiveQueryBudget() {
+    return active_budget;
+}
+
+QueryBudgetScope::QueryBudgetScope(QueryBudget* budget)
+    : previous_(active_budget) {
+    active_budget = budget;
+}
+
+QueryBudgetScope::~QueryBudgetScope() {
+    active_budget = previous_;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// scoring looks at the budget of the query after every this many postings
+const size_t DEADLINE_CHECK_INTERVAL = 256;
+
+// Lets the caller stop a query it submitted; copies share one flag, so the caller keeps a copy
+// and the query gets another
+class CancellationToken {
+public:
+    CancellationToken()
+        : cancelled_(std::make_shared<std::atomic<bool>>(false)) {
+    }
+    void Cancel() {
+        cancelled_->store(true, std::memory_order_relaxed);
+    }
+    bool IsCancelled() const {
+        return cancelled_->load(std::memory_order_relaxed);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Deadline and cancellation of the query running on a thread. Scoring stops once either fires and
+// the query returns what it has scored so far, marked as truncated. A budget belongs to one thread.
+class QueryBudget {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    QueryBudget(Clock::time_point deadline, CancellationToken cancellation)
+        : deadline_(deadline)
+        , cancellation_(std::move(cancellation)) {
+    }
+
+    // Reads the clock and the token; once exhausted the budget stays exhausted
+    bool CheckExhausted() {
+        if (!truncated_ && (cancellation_.IsCancelled() || Clock::now() >= deadline_)) {
+            truncated_ = true;
+        }
+        return truncated_;
+    }
+    // True if scoring was stopped early
+    bool IsTruncated() const {
+        return truncated_;
+    }
+
+private:
+    Clock::time_point deadline_;
+    CancellationToken cancellation_;
+    bool truncated_ = false;
+};
+
+// nullptr when the query on this thread runs without a budget
+QueryBudget* GetActiveQueryBudget();
+
+// Makes the budget the active one on this thread for the scope's lifetime
+class QueryBudgetScope {
+public:
+    explicit QueryBudgetScope(QueryBudget* budget);
+    ~QueryBudgetScope();
+    QueryBudgetScope(const QueryBudgetScope&) = delete;
+    QueryBudgetScope& operator=(const QueryBudgetScope&) = delete;
+
+private:
+    QueryBudget* previous_;
+};
+
+// Counts the postings a scoring loop visits and checks the active budget after every
+// DEADLINE_CHECK_INTERVAL of them; without a budget a visit is one predictable branch
+class BudgetCheckpoint {
+public:
+    BudgetCheckpoint()
+        : budget_(GetActiveQueryBudget()) {
+    }
+    // True once the query must stop scoring
+    bool Visit() {
+        return budget_ != nullptr && ++visited_ % DEADLINE_CHECK_INTERVAL == 0 && budget_->CheckExhausted();
+    }
+    bool IsExhausted() const {
+        return budget_ != nullptr && budget_->IsTruncated();
+    }
+
+private:
+    QueryBudget* budget_;
+    size_t visited_ = 0;
+};
@@ -0,0 +1,49 @@
+#include "query_executor.h"
+
+QueryExecutor::QueryExecutor(size_t thread_count) {
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this]() {
+            Run();
+        });
+    }
+}
+
+QueryExecutor::~QueryExecutor() {
+    std::deque<std::function<void()>> dropped_tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        dropped_tasks.swap(tasks_);
+    }
+    task_available_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void QueryExecutor::Enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    task_available_.notify_one();
+}
+
+void QueryExecutor::Run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            task_available_.wait(lock, [this]() {
+                return stopping_ || !tasks_.empty();
+            });
+            if (stopping_) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed pool of threads running submitted tasks in the order they were submitted. Destroying the
+// executor waits for the running tasks; tasks still queued are dropped and their futures report
+// std::future_errc::broken_promise.
+class QueryExecutor {
+public:
+    explicit QueryExecutor(size_t thread_count);
+    ~QueryExecutor();
+    QueryExecutor(const QueryExecutor&) = delete;
+    QueryExecutor& operator=(const QueryExecutor&) = delete;
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> Submit(Function function) {
+        // std::function needs a copyable target, the task itself is move-only
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(std::move(function));
+        auto result = task->get_future();
+        Enqueue([task]() {
+            (*task)();
+        });
+        return result;
+    }
+
+    size_t GetThreadCount() const {
+        return threads_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable task_available_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void Enqueue(std::function<void()> task);
+    void Run();
+};
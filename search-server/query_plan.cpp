@@ -0,0 +1,19 @@
+#include "query_plan.h"
+
+using namespace std::string_literals;
+
+std::ostream& operator<<(std::ostream& out, const QueryPlan& plan) {
+    out << (plan.strategy == QueryStrategy::TERM_AT_A_TIME ? "term-at-a-time"s : "document-at-a-time"s)
+        << (plan.dense_accumulator ? ", dense accumulator"s : ""s)
+        << (plan.parallel ? ", parallel"s : ", sequential"s)
+        << ", cost "s << plan.estimated_cost << "\n"s;
+    out << "  exclude "s << plan.excluded_postings << " postings:"s;
+    for (const PlannedWord& word : plan.minus_words) {
+        out << " -"s << word.word << "("s << word.postings << ")"s;
+    }
+    out << "\n  score "s << plan.scored_postings << " postings:"s;
+    for (const PlannedWord& word : plan.plus_words) {
+        out << " "s << word.word << "("s << word.postings << ")"s;
+    }
+    return out << "\n"s;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <iostream>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+enum class QueryStrategy {
+    // accumulates relevance word by word in a document map
+    TERM_AT_A_TIME,
+    // walks all posting lists together in id order and scores each document once
+    DOCUMENT_AT_A_TIME,
+};
+
+struct PlannedWord {
+    std::string_view word;
+    size_t postings = 0;
+    int term_id = -1;
+    double inverse_document_freq = 0.0;
+};
+
+// Execution plan chosen from posting list lengths. Minus words are turned into an exclusion list
+// before any plus word is scored, plus words are evaluated from the most selective one.
+// The word lists come from the memory resource the plan is built with, an arena while a query runs.
+struct QueryPlan {
+    QueryPlan() = default;
+    explicit QueryPlan(std::pmr::memory_resource* resource)
+        : minus_words(resource)
+        , plus_words(resource) {
+    }
+
+    std::pmr::vector<PlannedWord> minus_words;
+    std::pmr::vector<PlannedWord> plus_words;
+    size_t excluded_postings = 0;
+    size_t scored_postings = 0;
+    QueryStrategy strategy = QueryStrategy::DOCUMENT_AT_A_TIME;
+    // term-at-a-time accumulates into an array indexed by document id instead of a map,
+    // with the SIMD kernels of scoring_kernels.h
+    bool dense_accumulator = false;
+    bool parallel = false;
+    double estimated_cost = 0.0;
+};
+
+std::ostream& operator<<(std::ostream& out, const QueryPlan& plan);
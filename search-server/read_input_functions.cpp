@@ -4,14 +4,22 @@
 
 
 std::string ReadLine() {
+    return ReadLine(std::cin);
+}
+
+std::string ReadLine(std::istream& input) {
     std::string s;
-    getline(std::cin, s);
+    getline(input, s);
     return s;
 }
 
 int ReadLineWithNumber() {
+    return ReadLineWithNumber(std::cin);
+}
+
+int ReadLineWithNumber(std::istream& input) {
     int result;
-    std::cin >> result;
-    ReadLine();
+    input >> result;
+    ReadLine(input);
     return result;
 }
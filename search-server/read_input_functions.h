@@ -1,6 +1,9 @@
 #pragma once
+#include <iostream>
 #include <string>
 
 std::string ReadLine();
+std::string ReadLine(std::istream& input);
 
 int ReadLineWithNumber();
+int ReadLineWithNumber(std::istream& input);
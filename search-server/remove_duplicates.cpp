@@ -1,23 +1,96 @@
 #include "remove_duplicates.h"
 #include "search_server.h"
+#include <algorithm>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <numeric>
 #include <string_view>
+#include <unordered_map>
+
+namespace {
+
+struct Fingerprint {
+    uint64_t high = 0;
+    uint64_t low = 0;
+    
+    bool operator==(const Fingerprint& other) const {
+        return high == other.high && low == other.low;
+    }
+};
+
+struct FingerprintHasher {
+    size_t operator()(const Fingerprint& fingerprint) const {
+        return static_cast<size_t>(fingerprint.low ^ (fingerprint.high * 0x9E3779B97F4A7C15ull));
+    }
+};
+
+uint64_t Mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+// The forward index keeps the words of a document sorted, so the fingerprint depends only on the word
+// set; words are hashed by their content, not by where the dictionary stores them.
+Fingerprint ComputeFingerprint(const WordFrequencies& word_frequencies) {
+    Fingerprint fingerprint{0x6A09E667F3BCC908ull, 0xBB67AE8584CAA73Bull ^ word_frequencies.size()};
+    for (const auto& [word, _] : word_frequencies) {
+        const uint64_t term_id = std::hash<std::string_view>{}(word);
+        fingerprint.high = Mix(fingerprint.high ^ term_id) + 0x3C6EF372FE94F82Bull;
+        fingerprint.low = Mix(fingerprint.low + term_id * 0xA54FF53A5F1D36F1ull) ^ fingerprint.high;
+    }
+    return fingerprint;
+}
+
+bool HaveSameWords(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const auto& l, const auto& r) {
+        return l.first == r.first;
+    });
+}
+
+}  // namespace
 
 void RemoveDuplicates(SearchServer& search_server) {
-    std::set<std::set<std::string_view>> unique_docs;
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    const std::vector<WordFrequencies> document_words = search_server.GetWordFrequencies(document_ids);
+    std::vector<Fingerprint> fingerprints(document_ids.size());
+    std::transform(std::execution::par,
+                   document_words.begin(),
+                   document_words.end(),
+                   fingerprints.begin(),
+                   [](const WordFrequencies& words) {
+                        return ComputeFingerprint(words);
+                   });
+    
+    // a fingerprint match is confirmed by comparing the word sets, so results never depend on hash collisions;
+    // documents are visited by ascending id, so the lowest id of every group is kept whatever the order
+    // they were added in; representatives are positions in document_ids
+    std::vector<size_t> positions(document_ids.size());
+    std::iota(positions.begin(), positions.end(), size_t{0});
+    std::sort(positions.begin(), positions.end(), [&document_ids](size_t lhs, size_t rhs) {
+        return document_ids[lhs] < document_ids[rhs];
+    });
+    std::unordered_map<Fingerprint, std::vector<size_t>, FingerprintHasher> unique_docs;
+    unique_docs.reserve(document_ids.size());
     std::vector<int> ids_for_remove;
-    for (const int document_id : search_server) {
-        std::set<std::string_view> words;
-        std::map<std::string_view, double> res = search_server.GetWordFrequencies(document_id);
-        for (auto element : res) {
-            words.insert(element.first);
+    for (const size_t i : positions) {
+        std::vector<size_t>& representatives = unique_docs[fingerprints[i]];
+        const bool duplicate = std::any_of(representatives.begin(), representatives.end(), [&](size_t representative) {
+            return HaveSameWords(document_words[representative], document_words[i]);
+        });
+        if (duplicate) {
+            ids_for_remove.push_back(document_ids[i]);
+        } else {
+            representatives.push_back(i);
         }
-        auto success = unique_docs.insert(words).second;
-        if (!success) ids_for_remove.push_back(document_id);
     }
+    
+    search_server.RemoveDocuments(ids_for_remove);
     for (int id : ids_for_remove) {
-        search_server.RemoveDocument(id);
         std::cout << "Found duplicate document id " << id << std::endl;
     }
 }
-
-// changed in several rows
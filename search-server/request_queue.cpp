@@ -1,10 +1,17 @@
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 #include "request_queue.h"
 #include "document.h"
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
+using namespace std::string_literals;
+
+RequestQueue::RequestQueue(const SearchServer& search_server, size_t capacity)
 : search_server_(search_server)
-, empty_rerspones_(0) {
+, capacity_(capacity)
+, start_time_(Clock::now())
+, slots_(std::make_unique<Slot[]>(capacity)) {
+    if (capacity == 0) throw std::invalid_argument("request queue capacity must be positive"s);
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
@@ -20,20 +27,109 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query)
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return empty_rerspones_;
+    const auto requests = CollectRequests();
+    return static_cast<int>(std::count_if(requests.begin(), requests.end(), [](const QueryResult& request) {
+        return request.found_docs_amount == 0;
+    }));
 }
 
-void RequestQueue::UpdateStats(int new_responses) {
-    if (requests_.size() >= min_in_day_) {
-        if (requests_.front().found_docs_amount == 0) {
-            empty_rerspones_--;
-        }
-        requests_.pop_front();
+RequestStats RequestQueue::GetStats(Clock::duration window) const {
+    using namespace std::chrono;
+
+    const int64_t now = GetTimestamp();
+    const int64_t window_begin = now - duration_cast<nanoseconds>(window).count();
+    const auto requests = CollectRequests();
+
+    RequestStats stats;
+    int64_t oldest_in_window = now;
+    for (const QueryResult& request : requests) {
+        if (request.timestamp < window_begin) continue;
+        ++stats.requests;
+        if (request.found_docs_amount == 0) ++stats.no_result_requests;
+        const size_t bucket = std::min<size_t>(request.found_docs_amount, stats.result_count_distribution.size() - 1);
+        ++stats.result_count_distribution[bucket];
+        oldest_in_window = std::min(oldest_in_window, request.timestamp);
+    }
+
+    // the ring has been overwritten inside the window: only the retained part of it is observable
+    stats.window_truncated = requests.size() == capacity_ && oldest_in_window > window_begin
+                             && head_.load(std::memory_order_relaxed) > capacity_;
+    const int64_t covered_begin = stats.window_truncated ? oldest_in_window : std::max<int64_t>(window_begin, 0);
+    const double covered_seconds = static_cast<double>(now - covered_begin) / 1e9;
+
+    if (stats.requests > 0) {
+        stats.no_result_rate = static_cast<double>(stats.no_result_requests) / stats.requests;
+    }
+    if (covered_seconds > 0) {
+        stats.queries_per_second = stats.requests / covered_seconds;
     }
+    return stats;
+}
+
+uint64_t RequestQueue::GetTotalRequests() const {
+    uint64_t total = 0;
+    for (const Counter& counter : counters_) {
+        total += counter.requests.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t RequestQueue::GetTotalNoResultRequests() const {
+    uint64_t total = 0;
+    for (const Counter& counter : counters_) {
+        total += counter.no_result_requests.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void RequestQueue::UpdateStats(int new_responses) {
+    Counter& counter = counters_[GetCounterIndex()];
+    counter.requests.fetch_add(1, std::memory_order_relaxed);
     if (0 == new_responses) {
-        empty_rerspones_++;
-        requests_.push_back({0});
-    } else {
-        requests_.push_back({new_responses});
+        counter.no_result_requests.fetch_add(1, std::memory_order_relaxed);
     }
+
+    // seqlock write: odd sequence marks the slot as being rewritten. Writers whose tickets are capacity
+    // apart share a slot, so the slot is claimed with a CAS. A writer never waits: it drops its entry
+    // when another writer holds the slot or a later ticket has already filled it, so a writer descheduled
+    // mid-write costs at most the ring entries of the writers that lap it; the counters see every request.
+    const uint64_t ticket = head_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[ticket % capacity_];
+    const uint64_t busy_sequence = 2 * ticket + 1;
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    do {
+        if (sequence > busy_sequence || sequence % 2 == 1) {
+            return;
+        }
+    } while (!slot.sequence.compare_exchange_weak(sequence, busy_sequence, std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timestamp.store(GetTimestamp(), std::memory_order_relaxed);
+    slot.found_docs_amount.store(new_responses, std::memory_order_relaxed);
+    slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+}
+
+std::vector<RequestQueue::QueryResult> RequestQueue::CollectRequests() const {
+    std::vector<QueryResult> requests;
+    requests.reserve(capacity_);
+    for (size_t i = 0; i < capacity_; ++i) {
+        const Slot& slot = slots_[i];
+        const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence == 0 || sequence % 2 == 1) continue;
+        const QueryResult request = {slot.timestamp.load(std::memory_order_relaxed),
+                                     slot.found_docs_amount.load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+        requests.push_back(request);
+    }
+    return requests;
+}
+
+int64_t RequestQueue::GetTimestamp() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_time_).count();
+}
+
+size_t RequestQueue::GetCounterIndex() {
+    static std::atomic<size_t> next_index{0};
+    thread_local const size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % counter_stripes_;
+    return index;
 }
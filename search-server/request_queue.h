@@ -1,29 +1,67 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include <deque>
 #include "search_server.h"
 
+struct RequestStats {
+    uint64_t requests = 0;
+    uint64_t no_result_requests = 0;
+    double no_result_rate = 0.0;
+    double queries_per_second = 0.0;
+    std::array<uint64_t, MAX_RESULT_DOCUMENT_COUNT + 1> result_count_distribution = {};
+    bool window_truncated = false;
+};
+
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server);
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestQueue(const SearchServer& search_server, size_t capacity = min_in_day_);
 
     template <typename DocumentPredicate>
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
     int GetNoResultRequests() const;
-    
+
+    RequestStats GetStats(Clock::duration window) const;
+    uint64_t GetTotalRequests() const;
+    uint64_t GetTotalNoResultRequests() const;
+
 private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<int64_t> timestamp{0};
+        std::atomic<int> found_docs_amount{0};
+    };
+
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> no_result_requests{0};
+    };
+
     struct QueryResult {
+        int64_t timestamp;
         int found_docs_amount;
     };
-    
-    std::deque<QueryResult> requests_;
+
     const static int min_in_day_ = 1440;
+    const static size_t counter_stripes_ = 32;
     const SearchServer& search_server_;
-    int empty_rerspones_;
-    
+    const size_t capacity_;
+    const Clock::time_point start_time_;
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    std::array<Counter, counter_stripes_> counters_;
+
     void UpdateStats(int new_responses);
+    std::vector<QueryResult> CollectRequests() const;
+    int64_t GetTimestamp() const;
+    static size_t GetCounterIndex();
 };
 
 template <typename DocumentPredicate>
@@ -0,0 +1,227 @@
+#include <exception>
+#include <stdexcept>
+#include "request_scheduler.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+uint64_t ToNanoseconds(std::chrono::steady_clock::duration duration) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+// weight of the newest sample in the moving average of the execution time
+const double SERVICE_TIME_SMOOTHING = 0.1;
+
+// Checks the config before the scheduler clamps the initial limit between its bounds
+const RequestSchedulerConfig& ValidateConfig(const RequestSchedulerConfig& config) {
+    if (config.min_concurrency == 0 || config.min_concurrency > config.max_concurrency) {
+        throw std::invalid_argument("concurrency bounds must satisfy 0 < min <= max"s);
+    }
+    if (config.max_queue_length == 0 || config.decrease_factor <= 0.0 || config.decrease_factor >= 1.0) {
+        throw std::invalid_argument("queue length must be positive and decrease factor in (0, 1)"s);
+    }
+    return config;
+}
+
+}  // namespace
+
+RequestScheduler::RequestScheduler(const SearchServer& search_server, RequestSchedulerConfig config)
+    : search_server_(search_server)
+    , config_(ValidateConfig(config))
+    , concurrency_limit_(std::clamp(config_.initial_concurrency, config_.min_concurrency, config_.max_concurrency)) {
+    workers_.reserve(config.max_concurrency);
+    for (size_t i = 0; i < config.max_concurrency; ++i) {
+        workers_.emplace_back([this]() {
+            Run();
+        });
+    }
+}
+
+RequestScheduler::~RequestScheduler() {
+    std::array<std::deque<Request>, REQUEST_PRIORITY_COUNT> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        abandoned.swap(queues_);
+    }
+    dispatch_ready_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    for (auto& queue : abandoned) {
+        for (Request& request : queue) {
+            Reject(request, RequestOutcome::REJECTED_OVERLOAD);
+        }
+    }
+}
+
+std::future<ScheduledResult> RequestScheduler::Submit(const std::string_view raw_query, DocumentStatus status,
+                                                      RequestPriority priority, Clock::time_point queue_deadline) {
+    const auto now = Clock::now();
+    Request request{std::string(raw_query), status, priority, now, queue_deadline, {}};
+    std::future<ScheduledResult> result = request.result.get_future();
+    const size_t priority_index = static_cast<size_t>(priority);
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // checked before the queue length, so a request that is rejected for its deadline sheds nothing;
+    // once every slot is busy the requests ahead leave the queue concurrency limit at a time
+    const size_t waiting_ahead = CountRequestsAhead(priority) + running_;
+    if (waiting_ahead >= concurrency_limit_) {
+        const double rounds = static_cast<double>(waiting_ahead - concurrency_limit_ + 1) / concurrency_limit_;
+        const auto expected_wait = std::chrono::nanoseconds(static_cast<int64_t>(rounds * average_service_ns_));
+        if (now + expected_wait > queue_deadline) {
+            ++rejected_deadline_[priority_index];
+            lock.unlock();
+            Reject(request, RequestOutcome::REJECTED_DEADLINE);
+            return result;
+        }
+    }
+
+    if (queues_[0].size() + queues_[1].size() >= config_.max_queue_length) {
+        // a full queue sheds its newest batch request before it turns an interactive one away
+        auto& batch_queue = queues_[static_cast<size_t>(RequestPriority::BATCH)];
+        if (priority == RequestPriority::INTERACTIVE && !batch_queue.empty()) {
+            Request shed = std::move(batch_queue.back());
+            batch_queue.pop_back();
+            ++rejected_overload_[static_cast<size_t>(RequestPriority::BATCH)];
+            Reject(shed, RequestOutcome::REJECTED_OVERLOAD);
+        } else {
+            ++rejected_overload_[priority_index];
+            lock.unlock();
+            Reject(request, RequestOutcome::REJECTED_OVERLOAD);
+            return result;
+        }
+    }
+    queues_[priority_index].push_back(std::move(request));
+    lock.unlock();
+    dispatch_ready_.notify_one();
+    return result;
+}
+
+std::future<ScheduledResult> RequestScheduler::Submit(const std::string_view raw_query, RequestPriority priority,
+                                                      Clock::duration queue_timeout) {
+    return Submit(raw_query, DocumentStatus::ACTUAL, priority, Clock::now() + queue_timeout);
+}
+
+RequestSchedulerStats RequestScheduler::GetStats() const {
+    RequestSchedulerStats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.served = served_;
+        stats.failed = failed_;
+        stats.rejected_overload = rejected_overload_;
+        stats.rejected_deadline = rejected_deadline_;
+        for (size_t i = 0; i < REQUEST_PRIORITY_COUNT; ++i) {
+            stats.queued[i] = queues_[i].size();
+        }
+        stats.running = running_;
+        stats.concurrency_limit = concurrency_limit_;
+    }
+    stats.queue_time = queue_time_.GetSnapshot();
+    stats.service_time = service_time_.GetSnapshot();
+    return stats;
+}
+
+size_t RequestScheduler::CountRequestsAhead(RequestPriority priority) const {
+    size_t count = 0;
+    for (size_t i = 0; i <= static_cast<size_t>(priority); ++i) {
+        count += queues_[i].size();
+    }
+    return count;
+}
+
+bool RequestScheduler::HasDispatchableRequest() const {
+    return running_ < concurrency_limit_ && (!queues_[0].empty() || !queues_[1].empty());
+}
+
+void RequestScheduler::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        dispatch_ready_.wait(lock, [this]() {
+            return stopping_ || HasDispatchableRequest();
+        });
+        if (stopping_) {
+            return;
+        }
+        auto& queue = queues_[0].empty() ? queues_[1] : queues_[0];
+        Request request = std::move(queue.front());
+        queue.pop_front();
+        const size_t priority_index = static_cast<size_t>(request.priority);
+        const auto start_time = Clock::now();
+        if (start_time > request.deadline) {
+            ++rejected_deadline_[priority_index];
+            lock.unlock();
+            Reject(request, RequestOutcome::REJECTED_DEADLINE, start_time);
+            lock.lock();
+            continue;
+        }
+        ++running_;
+        lock.unlock();
+
+        ScheduledResult result;
+        result.queue_time = start_time - request.enqueue_time;
+        queue_time_.Record(ToNanoseconds(result.queue_time));
+        std::exception_ptr error;
+        try {
+            result.documents = search_server_.FindTopDocuments(request.raw_query, request.status);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        const auto service_time = Clock::now() - start_time;
+        if (!error) {
+            service_time_.Record(ToNanoseconds(service_time));
+            result.service_time = service_time;
+        }
+
+        lock.lock();
+        --running_;
+        // the statistics already count the request once its caller wakes up
+        if (error) {
+            // a query that threw, e.g. on invalid syntax, says nothing about the load, so it leaves the
+            // limit and the expected service time alone
+            ++failed_[priority_index];
+            request.result.set_exception(error);
+            continue;
+        }
+        ++served_[priority_index];
+        const size_t previous_limit = concurrency_limit_;
+        AdjustConcurrencyLimit(service_time);
+        if (concurrency_limit_ > previous_limit) {
+            dispatch_ready_.notify_all();
+        }
+        request.result.set_value(std::move(result));
+    }
+}
+
+void RequestScheduler::AdjustConcurrencyLimit(Clock::duration service_time) {
+    const double service_ns = static_cast<double>(ToNanoseconds(service_time));
+    average_service_ns_ = average_service_ns_ == 0.0
+                          ? service_ns
+                          : average_service_ns_ + SERVICE_TIME_SMOOTHING * (service_ns - average_service_ns_);
+    ++completions_since_decrease_;
+    if (service_time > config_.latency_target) {
+        completions_since_increase_ = 0;
+        // one cut per window of limit requests, so a burst of slow requests does not collapse the limit
+        if (completions_since_decrease_ >= concurrency_limit_) {
+            concurrency_limit_ = std::max(config_.min_concurrency,
+                                          static_cast<size_t>(concurrency_limit_ * config_.decrease_factor));
+            completions_since_decrease_ = 0;
+        }
+        return;
+    }
+    // the limit only grows while it is what holds requests back
+    const bool limit_reached = running_ + 1 >= concurrency_limit_;
+    if (limit_reached && ++completions_since_increase_ >= concurrency_limit_
+        && concurrency_limit_ < config_.max_concurrency) {
+        ++concurrency_limit_;
+        completions_since_increase_ = 0;
+    }
+}
+
+void RequestScheduler::Reject(Request& request, RequestOutcome outcome, Clock::time_point now) {
+    ScheduledResult result;
+    result.outcome = outcome;
+    result.queue_time = now - request.enqueue_time;
+    request.result.set_value(std::move(result));
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "document.h"
+#include "metrics.h"
+#include "search_server.h"
+
+// Interactive requests are always dispatched before batch ones
+enum class RequestPriority {
+    INTERACTIVE,
+    BATCH,
+};
+
+const size_t REQUEST_PRIORITY_COUNT = 2;
+
+enum class RequestOutcome {
+    SERVED,
+    // the queue was full, or the request was queued for batch work and made room for an interactive one
+    REJECTED_OVERLOAD,
+    // the request would not, or did not, leave the queue before its deadline
+    REJECTED_DEADLINE,
+};
+
+struct ScheduledResult {
+    RequestOutcome outcome = RequestOutcome::SERVED;
+    std::vector<Document> documents;
+    // time from submission to dispatch or rejection
+    std::chrono::steady_clock::duration queue_time{};
+    // execution time of a served request
+    std::chrono::steady_clock::duration service_time{};
+};
+
+struct RequestSchedulerConfig {
+    // bounds of the adaptive concurrency limit; max_concurrency threads are started
+    size_t min_concurrency = 1;
+    size_t max_concurrency = 2 * std::max(1u, std::thread::hardware_concurrency());
+    size_t initial_concurrency = std::max(1u, std::thread::hardware_concurrency());
+    // requests waiting at once, over all priorities
+    size_t max_queue_length = 1024;
+    // the limit shrinks while requests take longer than this to execute and grows while they do not
+    std::chrono::steady_clock::duration latency_target = std::chrono::milliseconds(50);
+    double decrease_factor = 0.8;
+};
+
+struct RequestSchedulerStats {
+    std::array<uint64_t, REQUEST_PRIORITY_COUNT> served = {};
+    // requests whose query threw; their future holds the exception
+    std::array<uint64_t, REQUEST_PRIORITY_COUNT> failed = {};
+    std::array<uint64_t, REQUEST_PRIORITY_COUNT> rejected_overload = {};
+    std::array<uint64_t, REQUEST_PRIORITY_COUNT> rejected_deadline = {};
+    // requests waiting and executing at the moment of the snapshot
+    std::array<size_t, REQUEST_PRIORITY_COUNT> queued = {};
+    size_t running = 0;
+    size_t concurrency_limit = 0;
+    HistogramSnapshot queue_time;
+    HistogramSnapshot service_time;
+};
+
+// Admission control in front of a SearchServer. Requests wait in a queue per priority and run on the
+// scheduler's threads, at most concurrency limit of them at once, so an overload turns into queueing
+// and rejections instead of every query slowing down. A request carries a queue deadline: it is
+// rejected on arrival when the requests ahead of it are not expected to clear in time, and dropped if
+// the deadline passes while it waits. The limit adapts to the measured execution time, adding one
+// slot per limit requests served within the latency target and cutting it by decrease_factor, at most
+// once per limit requests, when they run slower. The index must not change while requests run.
+class RequestScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RequestScheduler(const SearchServer& search_server, RequestSchedulerConfig config = {});
+    // Waits for the running requests; queued ones are rejected with REJECTED_OVERLOAD
+    ~RequestScheduler();
+    RequestScheduler(const RequestScheduler&) = delete;
+    RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+    std::future<ScheduledResult> Submit(const std::string_view raw_query, DocumentStatus status, RequestPriority priority,
+                                        Clock::time_point queue_deadline);
+    std::future<ScheduledResult> Submit(const std::string_view raw_query, RequestPriority priority,
+                                        Clock::duration queue_timeout);
+
+    RequestSchedulerStats GetStats() const;
+
+private:
+    struct Request {
+        std::string raw_query;
+        DocumentStatus status;
+        RequestPriority priority;
+        Clock::time_point enqueue_time;
+        Clock::time_point deadline;
+        std::promise<ScheduledResult> result;
+    };
+
+    const SearchServer& search_server_;
+    const RequestSchedulerConfig config_;
+    mutable std::mutex mutex_;
+    std::condition_variable dispatch_ready_;
+    std::array<std::deque<Request>, REQUEST_PRIORITY_COUNT> queues_;
+    size_t running_ = 0;
+    size_t concurrency_limit_;
+    size_t completions_since_increase_ = 0;
+    size_t completions_since_decrease_ = 0;
+    // moving average of the execution time, used to predict the queue time of a new request
+    double average_service_ns_ = 0.0;
+    bool stopping_ = false;
+    std::array<uint64_t, REQUEST_PRIORITY_COUNT> served_ = {};
+    std::array<uint64_t, REQUEST_PRIORITY_COUNT> failed_ = {};
+    std::array<uint64_t, REQUEST_PRIORITY_COUNT> rejected_overload_ = {};
+    std::array<uint64_t, REQUEST_PRIORITY_COUNT> rejected_deadline_ = {};
+    LatencyHistogram queue_time_;
+    LatencyHistogram service_time_;
+    std::vector<std::thread> workers_;
+
+    // requests dispatched before a new request of this priority
+    size_t CountRequestsAhead(RequestPriority priority) const;
+    bool HasDispatchableRequest() const;
+    void Run();
+    void AdjustConcurrencyLimit(Clock::duration service_time);
+    static void Reject(Request& request, RequestOutcome outcome, Clock::time_point now = Clock::now());
+};
@@ -0,0 +1,114 @@
+#include "scoring_kernels.h"
+
+#if !defined(SEARCH_SERVER_DISABLE_SIMD) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SEARCH_SERVER_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// a fused multiply-add rounds once instead of twice, and the kernels must round exactly like the scalar loop
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+using namespace std::string_view_literals;
+
+namespace {
+
+void AccumulateScoresScalar(const int* document_ids, const double* term_freqs, size_t count,
+                            double inverse_document_freq, double* relevances) {
+    for (size_t i = 0; i < count; ++i) {
+        relevances[document_ids[i]] += term_freqs[i] * inverse_document_freq;
+    }
+}
+
+#ifdef SEARCH_SERVER_X86_KERNELS
+
+// AVX2 has a gather but no scatter, so the sums are stored lane by lane
+__attribute__((target("avx2")))
+void AccumulateScoresAvx2(const int* document_ids, const double* term_freqs, size_t count,
+                          double inverse_document_freq, double* relevances) {
+    const __m256d factor = _mm256_set1_pd(inverse_document_freq);
+    // a masked gather from a zero source: the plain one starts from an undefined register, which GCC reports
+    const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i ids = _mm_loadu_si128(reinterpret_cast<const __m128i*>(document_ids + i));
+        const __m256d current = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), relevances, ids, all_lanes, 8);
+        const __m256d sums = _mm256_add_pd(current, _mm256_mul_pd(_mm256_loadu_pd(term_freqs + i), factor));
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, sums);
+        relevances[document_ids[i]] = lanes[0];
+        relevances[document_ids[i + 1]] = lanes[1];
+        relevances[document_ids[i + 2]] = lanes[2];
+        relevances[document_ids[i + 3]] = lanes[3];
+    }
+    AccumulateScoresScalar(document_ids + i, term_freqs + i, count - i, inverse_document_freq, relevances);
+}
+
+// the ids of a block are distinct, so the lanes of a scatter never collide
+__attribute__((target("avx512f")))
+void AccumulateScoresAvx512(const int* document_ids, const double* term_freqs, size_t count,
+                            double inverse_document_freq, double* relevances) {
+    const __m512d factor = _mm512_set1_pd(inverse_document_freq);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(document_ids + i));
+        const __m512d current = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, ids, relevances, 8);
+        const __m512d sums = _mm512_add_pd(current, _mm512_mul_pd(_mm512_loadu_pd(term_freqs + i), factor));
+        _mm512_i32scatter_pd(relevances, ids, sums, 8);
+    }
+    AccumulateScoresScalar(document_ids + i, term_freqs + i, count - i, inverse_document_freq, relevances);
+}
+
+#endif
+
+}  // namespace
+
+void AccumulateScores(ScoringKernel kernel, const int* document_ids, const double* term_freqs, size_t count,
+                      double inverse_document_freq, double* relevances) {
+    switch (kernel) {
+#ifdef SEARCH_SERVER_X86_KERNELS
+        case ScoringKernel::AVX2:
+            AccumulateScoresAvx2(document_ids, term_freqs, count, inverse_document_freq, relevances);
+            return;
+        case ScoringKernel::AVX512:
+            AccumulateScoresAvx512(document_ids, term_freqs, count, inverse_document_freq, relevances);
+            return;
+#endif
+        default:
+            AccumulateScoresScalar(document_ids, term_freqs, count, inverse_document_freq, relevances);
+    }
+}
+
+void AccumulateScores(const int* document_ids, const double* term_freqs, size_t count,
+                      double inverse_document_freq, double* relevances) {
+    AccumulateScores(GetActiveScoringKernel(), document_ids, term_freqs, count, inverse_document_freq, relevances);
+}
+
+std::vector<ScoringKernel> GetSupportedScoringKernels() {
+    std::vector<ScoringKernel> kernels = {ScoringKernel::SCALAR};
+#ifdef SEARCH_SERVER_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back(ScoringKernel::AVX2);
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        kernels.push_back(ScoringKernel::AVX512);
+    }
+#endif
+    return kernels;
+}
+
+ScoringKernel GetActiveScoringKernel() {
+    static const ScoringKernel kernel = GetSupportedScoringKernels().back();
+    return kernel;
+}
+
+std::string_view GetScoringKernelName(ScoringKernel kernel) {
+    switch (kernel) {
+        case ScoringKernel::SCALAR: return "scalar"sv;
+        case ScoringKernel::AVX2: return "avx2"sv;
+        case ScoringKernel::AVX512: return "avx512"sv;
+    }
+    return {};
+}
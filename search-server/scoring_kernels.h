@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// postings are handed to a kernel in blocks of this size
+const size_t SCORING_BLOCK_SIZE = 256;
+
+enum class ScoringKernel {
+    SCALAR,
+    AVX2,
+    AVX512,
+};
+
+// Adds term_freqs[i] * inverse_document_freq to relevances[document_ids[i]] for every i. The ids of a
+// block must be distinct, which holds for postings of one word. Every kernel multiplies and then adds
+// in double precision without fused multiply-add, so all of them give bit-identical results.
+// The SIMD kernels are compiled for x86-64 with GCC or Clang unless SEARCH_SERVER_DISABLE_SIMD is defined.
+void AccumulateScores(ScoringKernel kernel, const int* document_ids, const double* term_freqs, size_t count,
+                      double inverse_document_freq, double* relevances);
+// Uses the best kernel the CPU supports, chosen once at startup
+void AccumulateScores(const int* document_ids, const double* term_freqs, size_t count,
+                      double inverse_document_freq, double* relevances);
+
+// kernels compiled in and supported by the CPU, the scalar one first
+std::vector<ScoringKernel> GetSupportedScoringKernels();
+ScoringKernel GetActiveScoringKernel();
+std::string_view GetScoringKernelName(ScoringKernel kernel);
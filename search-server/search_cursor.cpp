@@ -0,0 +1,55 @@
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "search_cursor.h"
+
+using namespace std::string_literals;
+
+// The token is "<relevance bits in hex>:<rating>:<id>"
+
+namespace {
+
+template <typename Number>
+Number ParseCursorField(std::string_view& token, char separator, int base) {
+    const size_t end = separator ? token.find(separator) : token.size();
+    if (end == std::string_view::npos) {
+        throw std::invalid_argument("Malformed search cursor"s);
+    }
+    Number value{};
+    const auto [last, error] = std::from_chars(token.data(), token.data() + end, value, base);
+    if (end == 0 || error != std::errc() || last != token.data() + end) {
+        throw std::invalid_argument("Malformed search cursor"s);
+    }
+    token.remove_prefix(separator ? end + 1 : end);
+    return value;
+}
+
+}  // namespace
+
+std::string SearchCursor::ToString() const {
+    if (is_start_) {
+        return {};
+    }
+    uint64_t relevance_bits = 0;
+    std::memcpy(&relevance_bits, &last_document_.relevance, sizeof(relevance_bits));
+    char buffer[16];
+    std::string token(buffer, std::to_chars(buffer, buffer + sizeof(buffer), relevance_bits, 16).ptr);
+    token += ':';
+    token += std::to_string(last_document_.rating);
+    token += ':';
+    token += std::to_string(last_document_.id);
+    return token;
+}
+
+SearchCursor SearchCursor::Parse(std::string_view token) {
+    if (token.empty()) {
+        return {};
+    }
+    const uint64_t relevance_bits = ParseCursorField<uint64_t>(token, ':', 16);
+    const int rating = ParseCursorField<int>(token, ':', 10);
+    const int id = ParseCursorField<int>(token, '\0', 10);
+    double relevance = 0.0;
+    std::memcpy(&relevance, &relevance_bits, sizeof(relevance));
+    return SearchCursor(Document(id, relevance, rating));
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "document.h"
+#include "top_documents.h"
+
+// Position in the ranked results of a query: the last document of the page already shown. The next
+// page holds the documents ranked after it, so a client pages through the results by passing the
+// cursor of each page to the following request. A default cursor stands before the first result.
+// The token form is opaque to clients; it keeps the relevance bit for bit, so a document sits exactly
+// on the cursor again when the index has not changed in between.
+class SearchCursor {
+public:
+    SearchCursor() = default;
+    explicit SearchCursor(const Document& last_document)
+        : last_document_(last_document)
+        , is_start_(false) {
+    }
+
+    bool IsStart() const {
+        return is_start_;
+    }
+    // True if the document comes after the cursor in the order of IsRankedHigherExact
+    bool Precedes(const Document& document) const {
+        return is_start_ || IsRankedHigherExact(last_document_, document);
+    }
+
+    // The start cursor is the empty token
+    std::string ToString() const;
+    // Throws std::invalid_argument if the token was not made by ToString
+    static SearchCursor Parse(std::string_view token);
+
+private:
+    Document last_document_;
+    bool is_start_ = true;
+};
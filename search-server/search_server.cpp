@@ -1,10 +1,14 @@
 #include <string>
 #include <cmath>
 #include <numeric>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <tuple>
 #include <execution>
 #include "search_server.h"
 #include "string_processing.h"
-#include "log_duration.h"
+#include "metrics.h"
 #include "concurrent_map.h"
 
 using namespace std::string_literals;
@@ -19,35 +23,55 @@ SearchServer::SearchServer(const std::string_view stop_words_text)
 {
 }
 
+SearchServer::~SearchServer() {
+    // no asynchronous query may outlive the index
+    query_executor_.executor.reset();
+    if (resources_) {
+        resources_->index_memory.BeginTeardown();
+    }
+}
+
 void SearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
     if ((document_id < 0)) throw std::invalid_argument("invalid document id value (less than zero)");
-    if ((documents_.count(document_id) > 0)) throw std::invalid_argument("a document with this id already exists");
-    
-    const auto words = SplitIntoWordsNoStop(document);
-    std::for_each(words.begin(),
-                  words.end(),
-                  [this](const std::string& word){
-                        all_words_.insert(word);
-                  });
+    if (live_documents_.Test(document_id)) throw std::invalid_argument("a document with this id already exists");
     
+    // the words and their frequencies are scratch data, only the index structures outlive the call
+    QueryArena arena;
+    const auto words = SplitIntoWordsNoStop(document, arena.GetResource());
     const double inv_word_count = 1.0 / words.size();
-    for (const std::string& word : words) {
-        word_to_document_freqs_[*(all_words_.find(word))][document_id] += inv_word_count;
+    std::pmr::map<int, double> term_frequencies(arena.GetResource());
+    for (const std::string_view word : words) {
+        term_frequencies[GetOrAddTermId(word)] += inv_word_count;
     }
     
-    std::map<std::string_view, double> word_frequencies;
-    for (const std::string& word : words) {
-        word_frequencies.insert({*(all_words_.find(word)), word_to_document_freqs_[word][document_id]});
+    std::pmr::vector<WordFrequency> word_frequencies(&resources_->forward_index_memory);
+    word_frequencies.reserve(term_frequencies.size());
+    std::pmr::vector<int> term_ids(&resources_->forward_index_memory);
+    term_ids.reserve(term_frequencies.size());
+    for (const auto [term_id, term_freq] : term_frequencies) {
+        term_id_to_postings_[term_id]->emplace(document_id, term_freq);
+        word_frequencies.emplace_back(term_id_to_word_[term_id], term_freq);
+        term_ids.push_back(term_id);
     }
+    std::sort(word_frequencies.begin(), word_frequencies.end(), [](const WordFrequency& lhs, const WordFrequency& rhs) {
+        return lhs.first < rhs.first;
+    });
     
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-    document_ids_.push_back(document_id);
-    document_to_word_freqs_.insert({document_id, word_frequencies});
+    const int rating = ComputeAverageRating(ratings);
+    documents_.Add(document_id, rating, status, static_cast<int>(words.size()), std::move(term_ids), std::move(word_frequencies));
+    status_bitmaps_[static_cast<int>(status)].Set(document_id);
+    live_documents_.Set(document_id);
+    rating_index_.emplace(rating, document_id);
+    document_id_limit_ = std::max(document_id_limit_, static_cast<size_t>(document_id) + 1);
+    ++index_epoch_;
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
+    TRACE_QUERY("FindTopDocuments");
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    return FindTopDocumentsWithCache(query, status, MatchMode::ANY, [this, &query, &arena, status]() {
+        return FindTopDocumentsByQuery(query, BitmapPredicate{&status_bitmaps_[static_cast<int>(status)]}, arena.GetResource());
     });
 }
 
@@ -55,9 +79,31 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status, MatchMode mode) const {
+    if (mode == MatchMode::ANY) {
+        return FindTopDocuments(raw_query, status);
+    }
+    TRACE_QUERY("FindTopDocuments(all)");
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    return FindTopDocumentsWithCache(query, status, mode, [this, &query, &arena, status]() {
+        auto matched_documents = FindAllDocumentsConjunctive(query, BitmapPredicate{&status_bitmaps_[static_cast<int>(status)]},
+                                                             arena.GetResource());
+        return SelectTopDocuments(matched_documents);
+    });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, MatchMode mode) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL, mode);
+}
+
 std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(std::execution::par, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
+    TRACE_QUERY("FindTopDocuments(par)");
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    return FindTopDocumentsWithCache(query, status, MatchMode::ANY, [this, &query, &arena, status]() {
+        return FindTopDocumentsByQuery(std::execution::par, query, BitmapPredicate{&status_bitmaps_[static_cast<int>(status)]},
+                                       arena.GetResource());
     });
 }
 
@@ -65,148 +111,703 @@ std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_po
     return FindTopDocuments(std::execution::par, raw_query, DocumentStatus::ACTUAL);
 }
 
-int SearchServer::GetDocumentCount() const {
-    return static_cast<int>(documents_.size());
+std::vector<Document> SearchServer::FindTopDocumentsAfter(const std::string_view raw_query, DocumentStatus status,
+                                                          const SearchCursor& cursor, size_t page_size) const {
+    TRACE_QUERY("FindTopDocumentsAfter");
+    if (page_size == 0) {
+        throw std::invalid_argument("Page size must be positive"s);
+    }
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    const auto matched_documents = FindAllDocuments(query, BitmapPredicate{&status_bitmaps_[static_cast<int>(status)]},
+                                                    arena.GetResource());
+    STAGE_TIMER(SearchStage::TOP_K);
+    TRACE_SPAN("sort");
+    PageTopDocuments top_documents(page_size);
+    for (const Document& document : matched_documents) {
+        if (cursor.Precedes(document)) {
+            top_documents.Push(document);
+        }
+    }
+    return top_documents.Extract();
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
-    if (documents_.count(document_id) == 0 ) throw std::out_of_range("Incorrect document id"s);
-    const auto query = ParseQuery(raw_query);
-    std::vector<std::string_view> matched_words = {};
+std::vector<Document> SearchServer::FindTopDocumentsAfter(const std::string_view raw_query, const SearchCursor& cursor,
+                                                          size_t page_size) const {
+    return FindTopDocumentsAfter(raw_query, DocumentStatus::ACTUAL, cursor, page_size);
+}
+
+std::future<TopDocumentsResult> SearchServer::FindTopDocumentsAsync(const std::string_view raw_query, DocumentStatus status,
+                                                                    std::chrono::steady_clock::time_point deadline,
+                                                                    CancellationToken cancellation) const {
+    std::call_once(query_executor_.started, [this]() {
+        query_executor_.executor = std::make_unique<QueryExecutor>(std::max(1u, std::thread::hardware_concurrency()));
+    });
+    return query_executor_.executor->Submit([this, query = std::string(raw_query), status, deadline, cancellation]() {
+        QueryBudget budget(deadline, cancellation);
+        QueryBudgetScope budget_scope(&budget);
+        TopDocumentsResult result;
+        result.documents = FindTopDocuments(query, status);
+        result.truncated = budget.IsTruncated();
+        return result;
+    });
+}
+
+std::future<TopDocumentsResult> SearchServer::FindTopDocumentsAsync(const std::string_view raw_query,
+                                                                    std::chrono::steady_clock::duration timeout,
+                                                                    CancellationToken cancellation) const {
+    return FindTopDocumentsAsync(raw_query, DocumentStatus::ACTUAL, std::chrono::steady_clock::now() + timeout,
+                                 std::move(cancellation));
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const {
+    TRACE_QUERY("FindTopDocuments(filter)");
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    return FindTopDocumentsByFilter(std::execution::seq, query, filter, arena.GetResource());
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const std::string_view raw_query,
+                                                     const DocumentFilter& filter) const {
+    TRACE_QUERY("FindTopDocuments(filter, par)");
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    return FindTopDocumentsByFilter(std::execution::par, query, filter, arena.GetResource());
+}
+
+DocumentBitmap SearchServer::CompileFilter(const DocumentFilter& filter) const {
+    TRACE_SPAN("compile_filter");
+    DocumentBitmap selection;
+    if (filter.statuses.empty()) {
+        selection = live_documents_;
+    }
+    for (const DocumentStatus status : filter.statuses) {
+        selection |= status_bitmaps_[static_cast<int>(status)];
+    }
     
-    for (const std::string_view word : query.minus_words) {
-        
-        if (word_to_document_freqs_.count(word) != 0) {
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                return {matched_words, documents_.at(document_id).status};
+    if (filter.min_rating != std::numeric_limits<int>::min() || filter.max_rating != std::numeric_limits<int>::max()) {
+        DocumentBitmap rated;
+        for (auto it = rating_index_.lower_bound({filter.min_rating, std::numeric_limits<int>::min()});
+             it != rating_index_.end() && it->first <= filter.max_rating; ++it) {
+            if (selection.Test(it->second)) {
+                rated.Set(it->second);
             }
         }
-        
+        selection = std::move(rated);
     }
+    selection.KeepRange(filter.min_id, filter.max_id);
+    return selection;
+}
+
+template <typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocumentsByFilter(ExecutionPolicy policy, const Query& query, const DocumentFilter& filter,
+                                                             std::pmr::memory_resource* resource) const {
+    const DocumentBitmap selection = CompileFilter(filter);
     
+    size_t posting_count = 0;
     for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) != 0) {
-            if (word_to_document_freqs_.at(word).count(document_id)) {
-                matched_words.push_back(*all_words_.find(word));
+        const auto postings = word_to_document_freqs_.find(word);
+        if (postings != word_to_document_freqs_.end()) {
+            posting_count += postings->second.size();
+        }
+    }
+    const size_t selected_count = selection.Count();
+    if (selected_count * query.plus_words.size() >= posting_count / SELECTIVE_FILTER_RATIO) {
+        if constexpr (std::is_same_v<ExecutionPolicy, std::execution::parallel_policy>) {
+            return FindTopDocumentsByQuery(std::execution::par, query, BitmapPredicate{&selection}, resource);
+        } else {
+            return FindTopDocumentsByQuery(query, BitmapPredicate{&selection}, resource);
+        }
+    }
+    
+    // the filter leaves so few documents that probing their own words is cheaper than walking the postings
+    std::pmr::vector<double> inverse_document_freqs(query.plus_words.size(), resource);
+    std::transform(query.plus_words.begin(), query.plus_words.end(), inverse_document_freqs.begin(), [this](std::string_view word) {
+        return word_to_document_freqs_.count(word) != 0 ? ComputeWordInverseDocumentFreq(word) : 0.0;
+    });
+    const std::vector<int> document_ids = selection.GetDocumentIds();
+    std::pmr::vector<Document> scored_documents(document_ids.size(), resource);
+    {
+        STAGE_TIMER(SearchStage::SCORING);
+        std::transform(policy, document_ids.begin(), document_ids.end(), scored_documents.begin(), [&](int document_id) {
+            const size_t slot = documents_.Find(document_id);
+            const WordFrequencies word_frequencies = documents_.GetWordFrequencies(slot);
+            Document document(document_id, 0.0, documents_.GetRating(slot));
+            bool matched = false;
+            for (size_t i = 0; i < query.plus_words.size(); ++i) {
+                const auto term_freq = word_frequencies.find(query.plus_words[i]);
+                if (term_freq != word_frequencies.end()) {
+                    document.relevance += term_freq->second * inverse_document_freqs[i];
+                    matched = true;
+                }
+            }
+            for (const std::string_view word : query.minus_words) {
+                if (word_frequencies.count(word) != 0) {
+                    matched = false;
+                }
+            }
+            if (!matched) {
+                document.id = -1;
+            }
+            return document;
+        });
+    }
+    scored_documents.erase(std::remove_if(scored_documents.begin(), scored_documents.end(), [](const Document& document) {
+        return document.id < 0;
+    }), scored_documents.end());
+    return SelectTopDocuments(scored_documents);
+}
+
+PreparedQuery SearchServer::Prepare(const std::string_view raw_query) const {
+    const Query query = ParseQuery(raw_query);
+    PreparedQuery prepared_query;
+    prepared_query.plus_words_.assign(query.plus_words.begin(), query.plus_words.end());
+    prepared_query.minus_words_.assign(query.minus_words.begin(), query.minus_words.end());
+    std::sort(prepared_query.minus_words_.begin(), prepared_query.minus_words_.end());
+    prepared_query.minus_words_.erase(std::unique(prepared_query.minus_words_.begin(), prepared_query.minus_words_.end()),
+                                      prepared_query.minus_words_.end());
+    ResolvePreparedQuery(prepared_query);
+    return prepared_query;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const {
+    TRACE_QUERY("FindTopDocuments(prepared)");
+    QueryArena arena;
+    PreparedQuery refreshed_query;
+    const PreparedQuery& resolved_query = GetResolvedQuery(query, refreshed_query);
+    return FindTopDocumentsWithCache(MakeQuery(resolved_query, arena.GetResource()), status, MatchMode::ANY,
+                                     [this, &resolved_query, &arena, status]() {
+        auto matched_documents = ExecuteQueryPlan(resolved_query.plan_, BitmapPredicate{&status_bitmaps_[static_cast<int>(status)]},
+                                                  arena.GetResource());
+        return SelectTopDocuments(matched_documents);
+    });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const {
+    return FindTopDocuments(query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery& query,
+                                                     DocumentStatus status) const {
+    TRACE_QUERY("FindTopDocuments(prepared, par)");
+    QueryArena arena;
+    PreparedQuery refreshed_query;
+    const PreparedQuery& resolved_query = GetResolvedQuery(query, refreshed_query);
+    return FindTopDocumentsWithCache(MakeQuery(resolved_query, arena.GetResource()), status, MatchMode::ANY,
+                                     [this, &resolved_query, &arena, status]() {
+        return FindTopDocumentsByPlan(std::execution::par, resolved_query.parallel_plan_,
+                                      BitmapPredicate{&status_bitmaps_[static_cast<int>(status)]}, arena.GetResource());
+    });
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery& query) const {
+    return FindTopDocuments(std::execution::par, query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+    STAGE_TIMER(SearchStage::MATCH_DOCUMENT);
+    TRACE_QUERY("MatchDocument(prepared)");
+    const size_t slot = documents_.Find(document_id);
+    if (slot == DocumentTable::NO_SLOT) throw std::out_of_range("Incorrect document id"s);
+    PreparedQuery refreshed_query;
+    const PreparedQuery& resolved_query = GetResolvedQuery(query, refreshed_query);
+    const DocumentStatus status = documents_.GetStatus(slot);
+    const std::pmr::vector<int>& document_terms = documents_.GetTermIds(slot);
+    
+    if (!IntersectWithDocumentTerms(resolved_query.minus_term_ids_, document_terms).empty()) {
+        return {std::vector<std::string_view>{}, status};
+    }
+    return {IntersectWithDocumentTerms(resolved_query.plus_term_ids_, document_terms), status};
+}
+
+void SearchServer::ResolvePreparedQuery(PreparedQuery& query) const {
+    const Query words = MakeQuery(query);
+    query.server_id_ = server_id_;
+    query.epoch_ = index_epoch_;
+    query.plus_term_ids_ = GetTermIds(words.plus_words);
+    query.minus_term_ids_ = GetTermIds(words.minus_words);
+    query.plan_ = PlanQuery(words, false);
+    query.parallel_plan_ = PlanQuery(words, true);
+}
+
+const PreparedQuery& SearchServer::GetResolvedQuery(const PreparedQuery& query, PreparedQuery& refreshed_query) const {
+    if (query.server_id_ == server_id_ && query.epoch_ == index_epoch_) {
+        return query;
+    }
+    refreshed_query.plus_words_ = query.plus_words_;
+    refreshed_query.minus_words_ = query.minus_words_;
+    ResolvePreparedQuery(refreshed_query);
+    return refreshed_query;
+}
+
+SearchServer::Query SearchServer::MakeQuery(const PreparedQuery& query, std::pmr::memory_resource* resource) {
+    Query result(resource);
+    result.plus_words.assign(query.plus_words_.begin(), query.plus_words_.end());
+    result.minus_words.assign(query.minus_words_.begin(), query.minus_words_.end());
+    return result;
+}
+
+QueryPlan SearchServer::ExplainQuery(const std::string_view raw_query) const {
+    return PlanQuery(ParseQuery(raw_query), false);
+}
+
+QueryPlan SearchServer::ExplainQuery(std::execution::parallel_policy policy, const std::string_view raw_query) const {
+    return PlanQuery(ParseQuery(raw_query), true);
+}
+
+QueryPlan SearchServer::PlanQuery(const Query& query, bool allow_parallel, std::pmr::memory_resource* resource) const {
+    TRACE_SPAN("plan");
+    QueryPlan plan(resource);
+    const auto plan_words = [this](const std::pmr::vector<std::string_view>& words, std::pmr::vector<PlannedWord>& planned_words) {
+        planned_words.reserve(words.size());
+        size_t postings = 0;
+        for (const std::string_view word : words) {
+            const auto term = word_to_term_id_.find(word);
+            if (term == word_to_term_id_.end()) continue;
+            const auto& word_freqs = *term_id_to_postings_[term->second];
+            if (!word_freqs.empty()) {
+                planned_words.push_back({term_id_to_word_[term->second], word_freqs.size(), term->second,
+                                         ComputeInverseDocumentFreq(word_freqs.size())});
             }
         }
+        std::sort(planned_words.begin(), planned_words.end(), [](const PlannedWord& lhs, const PlannedWord& rhs) {
+            return lhs.word < rhs.word;
+        });
+        planned_words.erase(std::unique(planned_words.begin(), planned_words.end(), [](const PlannedWord& lhs, const PlannedWord& rhs) {
+            return lhs.word == rhs.word;
+        }), planned_words.end());
+        // the most selective words go first; ties keep the word order, without the buffer stable_sort would allocate
+        std::sort(planned_words.begin(), planned_words.end(), [](const PlannedWord& lhs, const PlannedWord& rhs) {
+            return std::tie(lhs.postings, lhs.word) < std::tie(rhs.postings, rhs.word);
+        });
+        for (const PlannedWord& planned_word : planned_words) {
+            postings += planned_word.postings;
+        }
+        return postings;
+    };
+    plan.excluded_postings = plan_words(query.minus_words, plan.minus_words);
+    plan.scored_postings = plan_words(query.plus_words, plan.plus_words);
+    
+    // costs are counted in posting visits: accumulation pays a map insertion for every posting,
+    // the merge pays a scan of all cursors for every posting
+    const double postings = static_cast<double>(plan.scored_postings);
+    const double accumulate_cost = postings * std::log2(std::min(postings, static_cast<double>(documents_.GetSize())) + 2.0);
+    const double merge_cost = postings * (plan.plus_words.size() + 1);
+    plan.parallel = allow_parallel && plan.plus_words.size() > 1 && plan.scored_postings >= PARALLEL_SCORING_POSTINGS_THRESHOLD;
+    if (plan.parallel) {
+        plan.strategy = QueryStrategy::TERM_AT_A_TIME;
+        plan.estimated_cost = accumulate_cost / plan.plus_words.size();
+    } else if (merge_cost <= accumulate_cost) {
+        plan.strategy = QueryStrategy::DOCUMENT_AT_A_TIME;
+        plan.estimated_cost = merge_cost;
+    } else {
+        plan.strategy = QueryStrategy::TERM_AT_A_TIME;
+        plan.estimated_cost = accumulate_cost;
+        // an array with a slot for every document id replaces the map when clearing and collecting it is
+        // cheaper than the insertions; walking the posting trees costs the same either way, so it does not
+        // compete with the merge
+        const double dense_cost = postings + static_cast<double>(document_id_limit_) / DENSE_ACCUMULATOR_IDS_PER_VISIT;
+        const bool dense_ids = document_id_limit_ <= DENSE_ACCUMULATOR_MAX_ID_SPREAD * documents_.GetSize();
+        if (dense_ids && dense_cost < accumulate_cost) {
+            plan.dense_accumulator = true;
+            plan.estimated_cost = dense_cost;
+        }
     }
+    plan.estimated_cost += plan.excluded_postings;
+    return plan;
+}
+
+void SearchServer::RecordQueryPlan(const QueryPlan& plan) {
+    PLANNER_DECISION(plan.strategy == QueryStrategy::TERM_AT_A_TIME ? PlannerDecision::TERM_AT_A_TIME
+                                                                    : PlannerDecision::DOCUMENT_AT_A_TIME);
+    PLANNER_DECISION(plan.parallel ? PlannerDecision::PARALLEL : PlannerDecision::SEQUENTIAL);
+    if (plan.dense_accumulator) {
+        PLANNER_DECISION(PlannerDecision::DENSE_ACCUMULATOR);
+    }
+    if (!plan.minus_words.empty()) {
+        PLANNER_DECISION(PlannerDecision::MINUS_WORDS_FIRST);
+    }
+}
+
+std::pmr::vector<int> SearchServer::CollectExcludedDocuments(const QueryPlan& plan, std::pmr::memory_resource* resource) const {
+    STAGE_TIMER(SearchStage::MINUS_WORDS);
+    TRACE_SPAN("minus_words");
+    std::pmr::vector<int> excluded_ids(resource);
+    excluded_ids.reserve(plan.excluded_postings);
+    for (const PlannedWord& planned_word : plan.minus_words) {
+        for (const auto& [document_id, _] : *term_id_to_postings_[planned_word.term_id]) {
+            excluded_ids.push_back(document_id);
+        }
+    }
+    if (plan.minus_words.size() > 1) {
+        std::sort(excluded_ids.begin(), excluded_ids.end());
+        excluded_ids.erase(std::unique(excluded_ids.begin(), excluded_ids.end()), excluded_ids.end());
+    }
+    return excluded_ids;
+}
+
+int SearchServer::GetDocumentCount() const {
+    return static_cast<int>(documents_.GetSize());
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
+    STAGE_TIMER(SearchStage::MATCH_DOCUMENT);
+    TRACE_QUERY("MatchDocument");
+    const size_t slot = documents_.Find(document_id);
+    if (slot == DocumentTable::NO_SLOT) throw std::out_of_range("Incorrect document id"s);
+    const auto query = ParseQuery(raw_query);
+    const DocumentStatus status = documents_.GetStatus(slot);
+    const std::pmr::vector<int>& document_terms = documents_.GetTermIds(slot);
     
-    return {matched_words, documents_.at(document_id).status};
+    if (!IntersectWithDocumentTerms(GetTermIds(query.minus_words), document_terms).empty()) {
+        return {std::vector<std::string_view>{}, status};
+    }
+    return {IntersectWithDocumentTerms(GetTermIds(query.plus_words), document_terms), status};
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy policy,
                                                                    const std::string_view raw_query, int document_id) const {
-    if (documents_.count(document_id) == 0 ) throw std::out_of_range("Incorrect document id"s);
-    const auto query = ParseQuery(std::execution::par, raw_query);
-    if (any_of(std::execution::par,
-               query.minus_words.begin(),
-               query.minus_words.end(),
-               [this, document_id](const std::string_view word) {
-                    return (word_to_document_freqs_.at(word).count(document_id));
-               }))
-    {
-        return {std::vector<std::string_view>{}, documents_.at(document_id).status};
+    STAGE_TIMER(SearchStage::MATCH_DOCUMENT);
+    TRACE_QUERY("MatchDocument(par)");
+    const size_t slot = documents_.Find(document_id);
+    if (slot == DocumentTable::NO_SLOT) throw std::out_of_range("Incorrect document id"s);
+    const auto query = ParseQuery(raw_query);
+    const DocumentStatus status = documents_.GetStatus(slot);
+    const std::pmr::vector<int>& document_terms = documents_.GetTermIds(slot);
+    
+    if (!IntersectWithDocumentTerms(std::execution::par, GetTermIds(query.minus_words), document_terms).empty()) {
+        return {std::vector<std::string_view>{}, status};
+    }
+    return {IntersectWithDocumentTerms(std::execution::par, GetTermIds(query.plus_words), document_terms), status};
+}
+
+std::vector<int> SearchServer::GetTermIds(const std::pmr::vector<std::string_view>& words) const {
+    std::vector<int> term_ids;
+    term_ids.reserve(words.size());
+    for (const std::string_view word : words) {
+        const auto term = word_to_term_id_.find(word);
+        if (term != word_to_term_id_.end()) {
+            term_ids.push_back(term->second);
+        }
+    }
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    return term_ids;
+}
+
+namespace {
+
+// Lower bound without a data-dependent branch in the loop, so the search does not stall on mispredictions
+template <typename Iterator>
+Iterator BranchlessLowerBound(Iterator first, size_t length, int value) {
+    while (length > 1) {
+        const size_t half = length / 2;
+        first += (first[half] < value) * half;
+        length -= half;
+    }
+    return first + (length == 1 && *first < value);
+}
+
+}  // namespace
+
+std::vector<std::string_view> SearchServer::IntersectWithDocumentTerms(const std::vector<int>& term_ids,
+                                                                       const std::pmr::vector<int>& document_terms) const {
+    // query terms are few and sorted, so each of them gallops forward from the previous match
+    // instead of walking the whole document
+    std::vector<std::string_view> matched_words;
+    auto first = document_terms.begin();
+    for (const int term_id : term_ids) {
+        size_t step = 1;
+        auto last = first;
+        while (last < document_terms.end() && *last < term_id) {
+            first = last + 1;
+            last += std::min<ptrdiff_t>(step, document_terms.end() - last);
+            step *= 2;
+        }
+        first = BranchlessLowerBound(first, last - first, term_id);
+        if (first == document_terms.end()) break;
+        if (*first == term_id) {
+            matched_words.push_back(term_id_to_word_[term_id]);
+        }
+    }
+    std::sort(matched_words.begin(), matched_words.end());
+    return matched_words;
+}
+
+std::vector<std::string_view> SearchServer::IntersectWithDocumentTerms(std::execution::parallel_policy policy,
+                                                                       const std::vector<int>& term_ids,
+                                                                       const std::pmr::vector<int>& document_terms) const {
+    if (term_ids.size() < PARALLEL_MATCH_WORD_THRESHOLD) {
+        return IntersectWithDocumentTerms(term_ids, document_terms);
+    }
+    std::vector<int> matched_terms(term_ids.size());
+    const auto last = std::copy_if(std::execution::par, term_ids.begin(), term_ids.end(), matched_terms.begin(),
+                                   [&document_terms](int term_id) {
+                                        return std::binary_search(document_terms.begin(), document_terms.end(), term_id);
+                                   });
+    std::vector<std::string_view> matched_words;
+    matched_words.reserve(last - matched_terms.begin());
+    for (auto it = matched_terms.begin(); it != last; ++it) {
+        matched_words.push_back(term_id_to_word_[*it]);
+    }
+    std::sort(std::execution::par, matched_words.begin(), matched_words.end());
+    return matched_words;
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(const std::string_view raw_query,
+                                                                                                   const std::vector<int>& document_ids) const {
+    STAGE_TIMER(SearchStage::MATCH_DOCUMENT);
+    TRACE_QUERY("MatchDocuments");
+    const auto query = ParseQuery(raw_query);
+    return MatchDocumentsByQuery(std::execution::seq, query, document_ids);
+}
+
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocuments(std::execution::parallel_policy policy,
+                                                                                                   const std::string_view raw_query,
+                                                                                                   const std::vector<int>& document_ids) const {
+    STAGE_TIMER(SearchStage::MATCH_DOCUMENT);
+    TRACE_QUERY("MatchDocuments(par)");
+    const auto query = ParseQuery(raw_query);
+    return MatchDocumentsByQuery(std::execution::par, query, document_ids);
+}
+
+template <typename ExecutionPolicy>
+std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> SearchServer::MatchDocumentsByQuery(ExecutionPolicy policy,
+                                                                                                          const Query& query,
+                                                                                                          const std::vector<int>& document_ids) const {
+    for (const int document_id : document_ids) {
+        if (documents_.Find(document_id) == DocumentTable::NO_SLOT) throw std::out_of_range("Incorrect document id"s);
     }
     
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    auto iter_of_end = std::copy_if(std::execution::par,
-                                    query.plus_words.begin(),
-                                    query.plus_words.end(),
-                                    matched_words.begin(),
-                                    [this, document_id](const std::string_view word){
-                    if (word_to_document_freqs_.count(word) != 0 &&
-                        word_to_document_freqs_.at(word).count(document_id))
-                    {
-                        return true;
-                    };
-                        return false;
+    // positions of the requested documents ordered by id, so every posting list is merged with them in one pass
+    std::vector<size_t> order(document_ids.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&document_ids](size_t lhs, size_t rhs) {
+        return document_ids[lhs] < document_ids[rhs];
     });
     
-    matched_words.erase(iter_of_end, matched_words.end());
-    std::sort(std::execution::par, matched_words.begin(), matched_words.end());
-    auto last = std::unique(std::execution::par, matched_words.begin(), matched_words.end());
-    matched_words.erase(last, matched_words.end());
+    // plus words first; ParseQuery already returns them sorted and unique, so the matched words keep that order
+    std::vector<std::pair<std::string_view, const Postings*>> words;
+    for (const auto* query_words : {&query.plus_words, &query.minus_words}) {
+        for (const std::string_view word : *query_words) {
+            const auto postings = word_to_document_freqs_.find(word);
+            if (postings != word_to_document_freqs_.end()) {
+                words.emplace_back(postings->first, &postings->second);
+            } else {
+                words.emplace_back(word, nullptr);
+            }
+        }
+    }
+    const size_t plus_word_count = query.plus_words.size();
     
-    std::transform(std::execution::par, matched_words.begin(), matched_words.end(), matched_words.begin(), [this](std::string_view word){
-        return std::string_view(*all_words_.find(std::string(word)));
+    // the algorithms below run over index ranges: parallel algorithms may pass copies of trivially
+    // copyable elements, so the position of an element cannot be taken from its address
+    std::vector<size_t> word_indexes(words.size());
+    std::iota(word_indexes.begin(), word_indexes.end(), 0);
+    std::vector<std::vector<char>> word_hits(words.size());
+    const uint64_t trace_id = GetActiveTraceId();
+    std::for_each(policy, word_indexes.begin(), word_indexes.end(), [&](const size_t word_index) {
+        TraceScope trace_scope(trace_id);
+        const auto& [word, postings] = words[word_index];
+        std::vector<char>& hits = word_hits[word_index];
+        hits.assign(document_ids.size(), 0);
+        if (postings == nullptr) return;
+        TRACE_TERM_SPAN("posting", word, static_cast<int64_t>(postings->size()));
+        if (order.size() * std::log2(postings->size() + 1.0) < postings->size()) {
+            for (const size_t position : order) {
+                hits[position] = postings->count(document_ids[position]) != 0;
+            }
+        } else {
+            auto posting = postings->begin();
+            for (const size_t position : order) {
+                while (posting != postings->end() && posting->first < document_ids[position]) {
+                    ++posting;
+                }
+                hits[position] = posting != postings->end() && posting->first == document_ids[position];
+            }
+        }
     });
     
-    return {matched_words, documents_.at(document_id).status};
+    std::vector<size_t> positions(document_ids.size());
+    std::iota(positions.begin(), positions.end(), 0);
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> result(document_ids.size());
+    std::transform(policy, positions.begin(), positions.end(), result.begin(), [&](const size_t position) {
+        const int document_id = document_ids[position];
+        const DocumentStatus status = documents_.GetStatus(documents_.Find(document_id));
+        std::vector<std::string_view> matched_words;
+        for (size_t word = plus_word_count; word < words.size(); ++word) {
+            if (word_hits[word][position]) {
+                return std::tuple{matched_words, status};
+            }
+        }
+        for (size_t word = 0; word < plus_word_count; ++word) {
+            if (word_hits[word][position]) {
+                matched_words.push_back(words[word].first);
+            }
+        }
+        return std::tuple{matched_words, status};
+    });
+    return result;
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    if (document_to_word_freqs_.count(document_id) > 0) {
-        return document_to_word_freqs_.at(document_id);
-    } else {
-        return empty_map_;
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    const size_t slot = documents_.Find(document_id);
+    if (slot == DocumentTable::NO_SLOT) {
+        return {};
     }
+    return documents_.GetWordFrequencies(slot);
+}
+
+std::vector<WordFrequencies> SearchServer::GetWordFrequencies(const std::vector<int>& document_ids) const {
+    std::vector<WordFrequencies> result(document_ids.size());
+    std::transform(document_ids.begin(), document_ids.end(), result.begin(), [this](int document_id) {
+        return GetWordFrequencies(document_id);
+    });
+    return result;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    if (std::count(document_ids_.begin(), document_ids_.end(), document_id) == 0) return;
-    for (const auto& [word, freqs]: document_to_word_freqs_.at(document_id)) {
-        word_to_document_freqs_.at(word).erase(document_id);
+    const size_t slot = documents_.Find(document_id);
+    if (slot == DocumentTable::NO_SLOT) return;
+    for (const int term_id : documents_.GetTermIds(slot)) {
+        term_id_to_postings_[term_id]->erase(document_id);
     }
-    
-    document_to_word_freqs_.erase(document_id);
-    documents_.erase(document_id);
-    std::remove_if(document_ids_.begin(), document_ids_.end(), [document_id](auto &element){
-            return element == document_id;
-    });
+    RemoveDocumentMetadata(document_id, slot);
+    ++index_epoch_;
 }
 
 void SearchServer::RemoveDocument(std::execution::parallel_policy policy, int document_id) {
-    if (std::count(document_ids_.begin(), document_ids_.end(), document_id) == 0) return;
-    std::map<std::string_view, double>& ref = document_to_word_freqs_.at(document_id);
-    std::vector<std::string_view> str_ptr(ref.size());
-    
-    std::transform(std::execution::par,
-                   ref.begin(),
-                   ref.end(),
-                   str_ptr.begin(),
-                   [](auto& element){
-                        return (element.first);
-                   });
+    const size_t slot = documents_.Find(document_id);
+    if (slot == DocumentTable::NO_SLOT) return;
+    const std::pmr::vector<int>& term_ids = documents_.GetTermIds(slot);
     std::for_each(std::execution::par,
-                  str_ptr.begin(),
-                  str_ptr.end(),
-                  [this, document_id](const std::string_view str){
-                        word_to_document_freqs_.at(str).erase(document_id);
+                  term_ids.begin(),
+                  term_ids.end(),
+                  [this, document_id](int term_id){
+                        term_id_to_postings_[term_id]->erase(document_id);
                   });
+    RemoveDocumentMetadata(document_id, slot);
+    ++index_epoch_;
+}
+
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    bool removed = false;
+    for (const int document_id : document_ids) {
+        const size_t slot = documents_.Find(document_id);
+        if (slot == DocumentTable::NO_SLOT) continue;
+        for (const int term_id : documents_.GetTermIds(slot)) {
+            term_id_to_postings_[term_id]->erase(document_id);
+        }
+        RemoveDocumentMetadata(document_id, slot);
+        removed = true;
+    }
+    if (removed) {
+        ++index_epoch_;
+    }
+}
+
+void SearchServer::RemoveDocumentMetadata(int document_id, size_t slot) {
+    status_bitmaps_[static_cast<int>(documents_.GetStatus(slot))].Reset(document_id);
+    live_documents_.Reset(document_id);
+    rating_index_.erase({documents_.GetRating(slot), document_id});
+    documents_.Remove(document_id);
+}
+
+void SearchServer::EnableQueryCache(size_t max_memory_bytes) {
+    query_cache_ = std::make_unique<QueryCache>(max_memory_bytes);
+}
+
+void SearchServer::DisableQueryCache() {
+    query_cache_.reset();
+}
+
+QueryCacheStats SearchServer::GetQueryCacheStats() const {
+    if (!query_cache_) {
+        return {};
+    }
+    return query_cache_->GetStats();
+}
+
+MemoryUsage SearchServer::GetMemoryUsage() const {
+    MemoryUsage usage;
+#ifdef SEARCH_SERVER_DISABLE_MEMORY_TRACKING
+    usage.term_dictionary = EstimateHashMapMemory(word_to_term_id_);
+    usage.postings = EstimateTreeMemory(word_to_document_freqs_);
+    for (const auto& [_, word_freqs] : word_to_document_freqs_) {
+        usage.postings += EstimateTreeMemory(word_freqs);
+    }
+    usage.forward_index = documents_.EstimateForwardIndexMemory();
+    usage.document_metadata = documents_.EstimateMetadataMemory() + EstimateTreeMemory(rating_index_);
+#else
+    usage.term_dictionary = resources_->term_memory.GetBytes();
+    usage.postings = resources_->postings_memory.GetBytes();
+    usage.forward_index = resources_->forward_index_memory.GetBytes();
+    usage.document_metadata = resources_->document_memory.GetBytes();
+    usage.index_pool_reserved = resources_->index_memory.GetReservedBytes();
+    usage.index_pool_peak = resources_->index_memory.GetPeakReservedBytes();
+    usage.exact = true;
+#endif
+    usage.term_dictionary += resources_->term_arena.GetMemoryUsage() + GetVectorMemory(term_id_to_word_) + GetVectorMemory(term_id_to_postings_);
+    usage.document_metadata += live_documents_.GetMemoryUsage();
+    for (const DocumentBitmap& bitmap : status_bitmaps_) {
+        usage.document_metadata += bitmap.GetMemoryUsage();
+    }
     
-    document_to_word_freqs_.erase(document_id);
-    documents_.erase(document_id);
-    
-    for (auto it = document_ids_.begin(); it < document_ids_.end(); it++) {
-        if (*it == document_id) {
-            document_ids_.erase(it);
-            break;
-        };
+    const size_t short_string_capacity = std::string().capacity();
+    usage.stop_words = EstimateTreeMemory(stop_words_);
+    for (const std::string& word : stop_words_) {
+        if (word.capacity() > short_string_capacity) {
+            usage.stop_words += word.capacity() + 1;
+        }
     }
+    usage.query_cache = query_cache_ ? query_cache_->GetStats().memory_usage : 0;
+    return usage;
+}
+
+void SearchServer::ResetPeakMemoryUsage() {
+    resources_->index_memory.ResetPeak();
+}
+
+uint64_t SearchServer::GenerateServerId() {
+    static std::atomic<uint64_t> next_server_id{1};
+    return next_server_id.fetch_add(1, std::memory_order_relaxed);
 }
 
 bool SearchServer::IsStopWord(const std::string_view word) const {
-    return stop_words_.count(std::string(word)) > 0;
+    return stop_words_.count(word) > 0;
 }
 bool SearchServer::IsValidWord(const std::string_view word) {
     return std::none_of(word.begin(), word.end(), [](char c) {
         return c >= '\0' && c < ' ';
     });
 }
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string_view text) const {
-    std::vector<std::string> words;
-    for (const std::string_view word : SplitIntoWordsView(text)) {
-        if (!IsValidWord(std::string(word))) {
+std::pmr::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view text,
+                                                                      std::pmr::memory_resource* resource) const {
+    STAGE_TIMER(SearchStage::TOKENIZE);
+    std::pmr::vector<std::string_view> words(resource);
+    SplitIntoWordsView(text, words);
+    words.erase(std::remove_if(words.begin(), words.end(), [this](const std::string_view word) {
+        if (!IsValidWord(word)) {
             throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
         }
-        if (!IsStopWord(std::string(word))) {
-            words.push_back(std::string(word));
-        }
-    }
+        return IsStopWord(word);
+    }), words.end());
     return words;
 }
 
+int SearchServer::GetOrAddTermId(const std::string_view word) {
+    const auto term = word_to_term_id_.find(word);
+    if (term != word_to_term_id_.end()) {
+        return term->second;
+    }
+    const std::string_view stored_word = resources_->term_arena.Store(word);
+    const int term_id = static_cast<int>(term_id_to_word_.size());
+    word_to_term_id_.emplace(stored_word, term_id);
+    term_id_to_word_.push_back(stored_word);
+    term_id_to_postings_.push_back(&word_to_document_freqs_[stored_word]);
+    return term_id;
+}
+
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
@@ -231,9 +832,15 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text
     return {word, is_minus, IsStopWord(word)};
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const {
-    Query result;
-    auto text_container = SplitIntoWordsView(text);
+SearchServer::Query SearchServer::ParseQuery(const std::string_view text, std::pmr::memory_resource* resource) const {
+    STAGE_TIMER(SearchStage::PARSE_QUERY);
+    TRACE_SPAN("ParseQuery");
+    Query result(resource);
+    std::pmr::vector<std::string_view> text_container(resource);
+    {
+        STAGE_TIMER(SearchStage::TOKENIZE);
+        SplitIntoWordsView(text, text_container);
+    }
     
     for (const std::string_view word : text_container) {
         const auto query_word = ParseQueryWord(word);
@@ -252,24 +859,86 @@ SearchServer::Query SearchServer::ParseQuery(const std::string_view text) const
     return result;
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::execution::parallel_policy policy, const std::string_view text) const {
-    Query result;
-    
-    for (const std::string_view word : SplitIntoWordsView(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
-            } else {
-                result.plus_words.push_back(query_word.data);
-            }
+double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const {
+    return ComputeInverseDocumentFreq(word_to_document_freqs_.at(word).size());
+}
+
+double SearchServer::ComputeInverseDocumentFreq(size_t document_freq) const {
+    return log(GetDocumentCount() * 1.0 / document_freq);
+}
+
+std::string SearchServer::MakeQueryCacheKey(const Query& query, DocumentStatus status, MatchMode mode) const {
+    // '\x01' and '\x02' can not appear inside valid words, so the key is unambiguous
+    std::vector<std::string_view> minus_words(query.minus_words.begin(), query.minus_words.end());
+    std::sort(minus_words.begin(), minus_words.end());
+    minus_words.erase(std::unique(minus_words.begin(), minus_words.end()), minus_words.end());
+
+    std::string key;
+    for (const std::string_view word : query.plus_words) {
+        key += word;
+        key += '\x01';
+    }
+    key += '\x02';
+    for (const std::string_view word : minus_words) {
+        key += word;
+        key += '\x01';
+    }
+    key += '\x02';
+    key += std::to_string(static_cast<int>(status));
+    key += '\x02';
+    key += std::to_string(MAX_RESULT_DOCUMENT_COUNT);
+    key += '\x02';
+    key += std::to_string(static_cast<int>(mode));
+    return key;
+}
+
+namespace {
+
+// Moves the posting cursor to the first document not less than document_id: a few steps forward first,
+// a tree search only when the target is far away, so both dense and sparse intersections stay cheap
+template <typename Postings>
+typename Postings::const_iterator SeekPosting(const Postings& postings, typename Postings::const_iterator cursor, int document_id) {
+    for (int step = 0; step < 8 && cursor != postings.end() && cursor->first < document_id; ++step) {
+        ++cursor;
+    }
+    if (cursor != postings.end() && cursor->first < document_id) {
+        cursor = postings.lower_bound(document_id);
+    }
+    return cursor;
+}
+
+}  // namespace
+
+void SearchServer::IntersectWithPostings(std::pmr::vector<Document>& candidates, const Postings& postings,
+                                         double inverse_document_freq) {
+    auto cursor = postings.begin();
+    size_t kept = 0;
+    for (const Document& candidate : candidates) {
+        cursor = SeekPosting(postings, cursor, candidate.id);
+        if (cursor == postings.end()) break;
+        if (cursor->first == candidate.id) {
+            candidates[kept] = candidate;
+            candidates[kept++].relevance += cursor->second * inverse_document_freq;
         }
     }
-    
-    return result;
+    candidates.resize(kept);
 }
 
+void SearchServer::SubtractPostings(std::pmr::vector<Document>& candidates, const Postings& postings) {
+    auto cursor = postings.begin();
+    const auto last = std::remove_if(candidates.begin(), candidates.end(), [&](const Document& candidate) {
+        cursor = SeekPosting(postings, cursor, candidate.id);
+        return cursor != postings.end() && cursor->first == candidate.id;
+    });
+    candidates.erase(last, candidates.end());
+}
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+std::vector<Document> SearchServer::SelectTopDocuments(const std::pmr::vector<Document>& matched_documents) {
+    STAGE_TIMER(SearchStage::TOP_K);
+    TRACE_SPAN("sort");
+    TopDocuments top_documents(MAX_RESULT_DOCUMENT_COUNT);
+    for (const Document& document : matched_documents) {
+        top_documents.Push(document);
+    }
+    return top_documents.Extract();
 }
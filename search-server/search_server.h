@@ -2,6 +2,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <array>
 #include <set>
 #include <stdexcept>
 #include <algorithm>
@@ -10,15 +12,64 @@
 #include <string_view>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <atomic>
 #include "document.h"
+#include "document_bitmap.h"
+#include "document_filter.h"
+#include "query_plan.h"
+#include "prepared_query.h"
+#include "query_arena.h"
+#include "string_arena.h"
+#include "index_memory_resource.h"
+#include "memory_usage.h"
+#include "word_frequencies.h"
+#include "document_table.h"
+#include "scoring_kernels.h"
+#include "top_documents.h"
+#include "search_cursor.h"
+#include "paginator.h"
+#include "query_deadline.h"
+#include "query_executor.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "query_cache.h"
+#include "metrics.h"
+#include "trace.h"
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
+// ANY scores documents containing at least one plus word, ALL only documents containing every plus word
+enum class MatchMode {
+    ANY,
+    ALL,
+};
+
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+// queries with fewer words are matched sequentially even by the parallel MatchDocument
+const size_t PARALLEL_MATCH_WORD_THRESHOLD = 256;
+// a filter that keeps this many times fewer documents than the query postings is scored document by document
+const size_t SELECTIVE_FILTER_RATIO = 8;
+// the parallel overloads score sequentially below this many postings
+const size_t PARALLEL_SCORING_POSTINGS_THRESHOLD = 1 << 15;
+// clearing and collecting this many slots of a dense accumulator costs about as much as one posting visit
+const size_t DENSE_ACCUMULATOR_IDS_PER_VISIT = 16;
+// the dense accumulator is only used while ids span at most this many times the number of documents,
+// so its memory stays proportional to the index
+const size_t DENSE_ACCUMULATOR_MAX_ID_SPREAD = 4;
+
+// Result of a query with a deadline. When scoring stopped early truncated is set and the documents are
+// the best of those scored so far, with the relevance they had gathered by then.
+struct TopDocumentsResult {
+    std::vector<Document> documents;
+    bool truncated = false;
+};
 
 class SearchServer {
 public:
@@ -26,6 +77,12 @@ public:
     explicit SearchServer(const StringContainer& stop_words);
     explicit SearchServer(const std::string& stop_words_text);
     explicit SearchServer(const std::string_view stop_words_text);
+    // A server is moved, e.g. out of a factory or inside a vector, but never copied. No query may run on
+    // it during the move, and the moved-from server may only be destroyed.
+    SearchServer(SearchServer&& other) = default;
+    SearchServer(const SearchServer&) = delete;
+    SearchServer& operator=(const SearchServer&) = delete;
+    ~SearchServer();
 
     void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
     
@@ -34,6 +91,11 @@ public:
     std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
     std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
 
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate, MatchMode mode) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status, MatchMode mode) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, MatchMode mode) const;
+
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy,
                                            const std::string_view raw_query,
@@ -67,6 +129,52 @@ public:
     std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy,
                                            const std::string_view raw_query) const;
     
+    // Filtered search evaluated on the status bitmaps and the rating index before any posting is scored
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, const DocumentFilter& filter) const;
+    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy policy,
+                                           const std::string_view raw_query,
+                                           const DocumentFilter& filter) const
+    {
+        return FindTopDocuments(raw_query, filter);
+    }
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy,
+                                           const std::string_view raw_query,
+                                           const DocumentFilter& filter) const;
+    
+    // Up to page_size documents ranked right after the cursor, for pages beyond MAX_RESULT_DOCUMENT_COUNT.
+    // Every call scores the query, but only documents after the cursor compete for the page, so the
+    // cost does not grow with the page number; the last document of a page is the cursor of the next one.
+    // Pages are ranked by IsRankedHigherExact, so relevances closer than EPSILON are not tied as on the first page.
+    std::vector<Document> FindTopDocumentsAfter(const std::string_view raw_query, DocumentStatus status,
+                                                const SearchCursor& cursor, size_t page_size) const;
+    std::vector<Document> FindTopDocumentsAfter(const std::string_view raw_query, const SearchCursor& cursor,
+                                                size_t page_size) const;
+    
+    // Runs the query on the server's executor, whose threads start with the first call. Scoring checks the
+    // deadline and the token between blocks of postings and, once either fires, stops and returns the best
+    // documents scored so far instead of running on; time spent waiting in the queue counts too. The
+    // index must not change while asynchronous queries run.
+    std::future<TopDocumentsResult> FindTopDocumentsAsync(const std::string_view raw_query, DocumentStatus status,
+                                                          std::chrono::steady_clock::time_point deadline,
+                                                          CancellationToken cancellation = {}) const;
+    std::future<TopDocumentsResult> FindTopDocumentsAsync(const std::string_view raw_query,
+                                                          std::chrono::steady_clock::duration timeout,
+                                                          CancellationToken cancellation = {}) const;
+    
+    // Parses the query and resolves its words to term ids and idf once; see PreparedQuery
+    PreparedQuery Prepare(const std::string_view raw_query) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery& query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy policy, const PreparedQuery& query) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const PreparedQuery& query, int document_id) const;
+    
+    // Returns the plan FindTopDocuments would execute for the query, without executing it
+    QueryPlan ExplainQuery(const std::string_view raw_query) const;
+    QueryPlan ExplainQuery(std::execution::parallel_policy policy, const std::string_view raw_query) const;
+    
     int GetDocumentCount() const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query, int document_id) const;
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::execution::sequenced_policy policy,
@@ -80,34 +188,103 @@ public:
                                                                             const std::string_view raw_query,
                                                                             int document_id) const;
     
-    auto begin() const { return document_ids_.begin(); }
-    auto end() const { return document_ids_.end(); }
+    // Parses the query once and merges its postings with the whole id list instead of matching documents one by one
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(const std::string_view raw_query,
+                                                                                       const std::vector<int>& document_ids) const;
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(std::execution::sequenced_policy policy,
+                                                                                       const std::string_view raw_query,
+                                                                                       const std::vector<int>& document_ids) const
+    {
+        return MatchDocuments(raw_query, document_ids);
+    }
+    
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocuments(std::execution::parallel_policy policy,
+                                                                                       const std::string_view raw_query,
+                                                                                       const std::vector<int>& document_ids) const;
     
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    auto begin() const { return documents_.begin(); }
+    auto end() const { return documents_.end(); }
+    
+    // Words of the document with their term frequencies; an empty view for an unknown id
+    WordFrequencies GetWordFrequencies(int document_id) const;
+    // The same for many documents at once, in the order of document_ids
+    std::vector<WordFrequencies> GetWordFrequencies(const std::vector<int>& document_ids) const;
 
     void RemoveDocument(int document_id);
     void RemoveDocument(std::execution::sequenced_policy policy, int document_id) {
         RemoveDocument(document_id);
     };
     void RemoveDocument(std::execution::parallel_policy policy, int document_id);
+    void RemoveDocuments(const std::vector<int>& document_ids);
+    
+    void EnableQueryCache(size_t max_memory_bytes);
+    void DisableQueryCache();
+    QueryCacheStats GetQueryCacheStats() const;
+    
+    // Bytes held by each part of the server; see MemoryUsage
+    MemoryUsage GetMemoryUsage() const;
+    // Starts a new window for MemoryUsage::index_pool_peak, e.g. before a burst of AddDocument calls
+    void ResetPeakMemoryUsage();
     
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
+    // document id -> term frequency of one word
+    using Postings = std::pmr::map<int, double>;
+
+    // Terms are packed into one arena and the tree and hash nodes of the index come from pools, so the
+    // index is not scattered over millions of heap allocations. They live on the heap, so the containers
+    // below keep their resources and term views when the server is moved
+    struct IndexResources {
+        StringArena term_arena;
+        IndexMemoryResource index_memory;
+        // every part of the index counts the bytes it holds in the shared pools, see GetMemoryUsage
+        TrackingMemoryResource term_memory{&index_memory};
+        TrackingMemoryResource postings_memory{&index_memory};
+        TrackingMemoryResource forward_index_memory{&index_memory};
+        TrackingMemoryResource document_memory{&index_memory};
+    };
+    // started by the first FindTopDocumentsAsync; a server moved into starts its own
+    struct LazyQueryExecutor {
+        std::once_flag started;
+        std::unique_ptr<QueryExecutor> executor;
+
+        LazyQueryExecutor() = default;
+        LazyQueryExecutor(LazyQueryExecutor&&) noexcept {
+        }
     };
-    const std::set<std::string> stop_words_;
-    std::set<std::string, std::less<>> all_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::vector<int> document_ids_;
-    std::map<int, std::map<std::string_view, double>> document_to_word_freqs_;
-    std::map<std::string_view, double> empty_map_ = {};
 
+    const std::set<std::string, std::less<>> stop_words_;
+    // must outlive the containers below
+    std::unique_ptr<IndexResources> resources_ = std::make_unique<IndexResources>();
+    std::pmr::unordered_map<std::string_view, int> word_to_term_id_{&resources_->term_memory};
+    std::vector<std::string_view> term_id_to_word_;
+    // entries of word_to_document_freqs_ are never erased, so the pointers stay valid
+    std::vector<Postings*> term_id_to_postings_;
+    std::pmr::map<std::string_view, Postings> word_to_document_freqs_{&resources_->postings_memory};
+    // metadata and forward index of every document: sorted term ids, used by MatchDocument instead of
+    // probing the inverted index per word, and the words sorted by word, viewed by GetWordFrequencies
+    DocumentTable documents_{&resources_->document_memory, &resources_->forward_index_memory};
+    std::array<DocumentBitmap, DOCUMENT_STATUS_COUNT> status_bitmaps_;
+    DocumentBitmap live_documents_;
+    std::pmr::set<std::pair<int, int>> rating_index_{&resources_->document_memory};
+    // one past the largest id ever added, the size of a dense accumulator
+    size_t document_id_limit_ = 0;
+    uint64_t index_epoch_ = 0;
+    // unique among all servers of the process, ties prepared queries to the server that resolved them
+    const uint64_t server_id_ = GenerateServerId();
+    std::unique_ptr<QueryCache> query_cache_;
+    // runs FindTopDocumentsAsync, stopped first thing in the destructor
+    mutable LazyQueryExecutor query_executor_;
+
+    static uint64_t GenerateServerId();
     bool IsStopWord(const std::string_view word) const;
     static bool IsValidWord(const std::string_view word);
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string_view text) const;
+    // the words are views into text
+    std::pmr::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text, std::pmr::memory_resource* resource) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
+    // Returns the id of the word, storing the word in the term arena when it is new to the index
+    int GetOrAddTermId(const std::string_view word);
+    // Clears everything but the postings, which the callers erase by the document's term ids
+    void RemoveDocumentMetadata(int document_id, size_t slot);
 
     struct QueryWord {
         std::string_view data;
@@ -118,19 +295,106 @@ private:
     QueryWord ParseQueryWord(const std::string_view text) const;
 
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        explicit Query(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : plus_words(resource)
+            , minus_words(resource) {
+        }
+        std::pmr::vector<std::string_view> plus_words;
+        std::pmr::vector<std::string_view> minus_words;
     };
 
-    Query ParseQuery(const std::string_view text) const;
-    Query ParseQuery(std::execution::parallel_policy policy, const std::string_view text) const;
+    Query ParseQuery(const std::string_view text, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
     
     double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    double ComputeInverseDocumentFreq(size_t document_freq) const;
+    std::string MakeQueryCacheKey(const Query& query, DocumentStatus status, MatchMode mode) const;
+
+    // Predicate of the status and filter overloads: a bit test instead of a documents_ lookup for every posting
+    struct BitmapPredicate {
+        const DocumentBitmap* bitmap;
+    };
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query query, DocumentPredicate document_predicate) const;
+    bool IsDocumentAccepted(const DocumentPredicate& document_predicate, int document_id) const {
+        const size_t slot = documents_.Find(document_id);
+        return document_predicate(document_id, documents_.GetStatus(slot), documents_.GetRating(slot));
+    }
+    bool IsDocumentAccepted(const BitmapPredicate& document_predicate, int document_id) const {
+        return document_predicate.bitmap->Test(document_id);
+    }
+    int GetDocumentRating(int document_id) const {
+        return documents_.GetRating(documents_.Find(document_id));
+    }
+
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(std::execution::parallel_policy policy, const Query query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocumentsByQuery(const Query& query, DocumentPredicate document_predicate,
+                                                  std::pmr::memory_resource* resource) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsByQuery(std::execution::parallel_policy policy, const Query& query,
+                                                  DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+    DocumentBitmap CompileFilter(const DocumentFilter& filter) const;
+    template <typename ExecutionPolicy>
+    std::vector<Document> FindTopDocumentsByFilter(ExecutionPolicy policy, const Query& query, const DocumentFilter& filter,
+                                                   std::pmr::memory_resource* resource) const;
+    template <typename Search>
+    std::vector<Document> FindTopDocumentsWithCache(const Query& query, DocumentStatus status, MatchMode mode, Search search) const;
+    // Picks the best of the scored documents with a bounded heap and copies them out of the query arena
+    static std::vector<Document> SelectTopDocuments(const std::pmr::vector<Document>& matched_documents);
+
+    std::vector<int> GetTermIds(const std::pmr::vector<std::string_view>& words) const;
+    std::vector<std::string_view> IntersectWithDocumentTerms(const std::vector<int>& term_ids,
+                                                             const std::pmr::vector<int>& document_terms) const;
+    std::vector<std::string_view> IntersectWithDocumentTerms(std::execution::parallel_policy policy,
+                                                             const std::vector<int>& term_ids,
+                                                             const std::pmr::vector<int>& document_terms) const;
+
+    template <typename ExecutionPolicy>
+    std::vector<std::tuple<std::vector<std::string_view>, DocumentStatus>> MatchDocumentsByQuery(ExecutionPolicy policy,
+                                                                                              const Query& query,
+                                                                                              const std::vector<int>& document_ids) const;
+
+    QueryPlan PlanQuery(const Query& query, bool allow_parallel,
+                        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+    void ResolvePreparedQuery(PreparedQuery& query) const;
+    const PreparedQuery& GetResolvedQuery(const PreparedQuery& query, PreparedQuery& refreshed_query) const;
+    static Query MakeQuery(const PreparedQuery& query, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    static void RecordQueryPlan(const QueryPlan& plan);
+    std::pmr::vector<int> CollectExcludedDocuments(const QueryPlan& plan, std::pmr::memory_resource* resource) const;
+    // Advances a cursor over the sorted excluded ids; documents must be checked in ascending id order
+    static bool IsExcluded(std::pmr::vector<int>::const_iterator& cursor, const std::pmr::vector<int>& excluded_ids, int document_id) {
+        while (cursor != excluded_ids.end() && *cursor < document_id) {
+            ++cursor;
+        }
+        return cursor != excluded_ids.end() && *cursor == document_id;
+    }
+
+    // Scoring works on the memory resource it is given and returns documents allocated from it
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> ExecuteQueryPlan(const QueryPlan& plan, DocumentPredicate document_predicate,
+                                                std::pmr::memory_resource* resource) const;
+    // Scores in parallel and selects the top documents in the same pass, never collecting all candidates
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsByPlan(std::execution::parallel_policy policy, const QueryPlan& plan,
+                                                 DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> ScoreTermAtATime(const QueryPlan& plan, const std::pmr::vector<int>& excluded_ids,
+                                                DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> ScoreTermAtATimeDense(const QueryPlan& plan, const std::pmr::vector<int>& excluded_ids,
+                                                     DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> ScoreDocumentAtATime(const QueryPlan& plan, const std::pmr::vector<int>& excluded_ids,
+                                                    DocumentPredicate document_predicate, std::pmr::memory_resource* resource) const;
+
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                std::pmr::memory_resource* resource) const;
+    template <typename DocumentPredicate>
+    std::pmr::vector<Document> FindAllDocumentsConjunctive(const Query& query, DocumentPredicate document_predicate,
+                                                           std::pmr::memory_resource* resource) const;
+    static void IntersectWithPostings(std::pmr::vector<Document>& candidates, const Postings& postings,
+                                      double inverse_document_freq);
+    static void SubtractPostings(std::pmr::vector<Document>& candidates, const Postings& postings);
 };
 
 template <typename StringContainer>
@@ -144,109 +408,352 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+    TRACE_QUERY("FindTopDocuments");
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    return FindTopDocumentsByQuery(query, document_predicate, arena.GetResource());
 }
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy,
                                                      const std::string_view raw_query,
                                                      DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(std::execution::par, query, document_predicate);
-
-    std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    TRACE_QUERY("FindTopDocuments(par)");
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    return FindTopDocumentsByQuery(std::execution::par, query, document_predicate, arena.GetResource());
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate,
+                                                     MatchMode mode) const {
+    if (mode == MatchMode::ANY) {
+        return FindTopDocuments(raw_query, document_predicate);
+    }
+    TRACE_QUERY("FindTopDocuments(all)");
+    QueryArena arena;
+    const auto query = ParseQuery(raw_query, arena.GetResource());
+    auto matched_documents = FindAllDocumentsConjunctive(query, document_predicate, arena.GetResource());
+    return SelectTopDocuments(matched_documents);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    TRACE_QUERY("FindTopDocuments(prepared)");
+    QueryArena arena;
+    PreparedQuery refreshed_query;
+    auto matched_documents = ExecuteQueryPlan(GetResolvedQuery(query, refreshed_query).plan_, document_predicate, arena.GetResource());
+    return SelectTopDocuments(matched_documents);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsByQuery(const Query& query, DocumentPredicate document_predicate,
+                                                            std::pmr::memory_resource* resource) const {
+    auto matched_documents = FindAllDocuments(query, document_predicate, resource);
+    return SelectTopDocuments(matched_documents);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsByQuery(std::execution::parallel_policy policy,
+                                                            const Query& query,
+                                                            DocumentPredicate document_predicate,
+                                                            std::pmr::memory_resource* resource) const {
+    return FindTopDocumentsByPlan(std::execution::par, PlanQuery(query, true, resource), document_predicate, resource);
+}
+
+template <typename Search>
+std::vector<Document> SearchServer::FindTopDocumentsWithCache(const Query& query, DocumentStatus status, MatchMode mode,
+                                                              Search search) const {
+    if (!query_cache_) {
+        return search();
+    }
+    const std::string key = MakeQueryCacheKey(query, status, mode);
+    if (auto cached = query_cache_->Get(key, index_epoch_)) {
+        return std::move(*cached);
+    }
+    auto matched_documents = search();
+    // results cut short by a deadline would be served to queries that have time to finish
+    const QueryBudget* budget = GetActiveQueryBudget();
+    if (budget == nullptr || !budget->IsTruncated()) {
+        query_cache_->Put(key, index_epoch_, matched_documents);
     }
     return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) != 0) {
-            
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+std::pmr::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                                          std::pmr::memory_resource* resource) const {
+    return ExecuteQueryPlan(PlanQuery(query, false, resource), document_predicate, resource);
+}
+
+template <typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::ExecuteQueryPlan(const QueryPlan& plan, DocumentPredicate document_predicate,
+                                                          std::pmr::memory_resource* resource) const {
+    RecordQueryPlan(plan);
+    const std::pmr::vector<int> excluded_ids = CollectExcludedDocuments(plan, resource);
+    if (plan.strategy == QueryStrategy::TERM_AT_A_TIME) {
+        if (plan.dense_accumulator) {
+            return ScoreTermAtATimeDense(plan, excluded_ids, document_predicate, resource);
+        }
+        return ScoreTermAtATime(plan, excluded_ids, document_predicate, resource);
+    }
+    return ScoreDocumentAtATime(plan, excluded_ids, document_predicate, resource);
+}
+
+template <typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::ScoreTermAtATime(const QueryPlan& plan, const std::pmr::vector<int>& excluded_ids,
+                                                          DocumentPredicate document_predicate,
+                                                          std::pmr::memory_resource* resource) const {
+    std::pmr::map<int, double> document_to_relevance(resource);
+    {
+        STAGE_TIMER(SearchStage::SCORING);
+        TRACE_SPAN("term_at_a_time");
+        BudgetCheckpoint budget_checkpoint;
+        for (const PlannedWord& planned_word : plan.plus_words) {
+            const auto& word_freqs = *term_id_to_postings_[planned_word.term_id];
+            TRACE_TERM_SPAN("posting", planned_word.word, static_cast<int64_t>(word_freqs.size()));
+            const double inverse_document_freq = planned_word.inverse_document_freq;
+            auto excluded = excluded_ids.begin();
+            for (const auto [document_id, term_freq] : word_freqs) {
+                if (budget_checkpoint.Visit()) {
+                    break;
+                }
+                if (!IsExcluded(excluded, excluded_ids, document_id) && IsDocumentAccepted(document_predicate, document_id)) {
                     document_to_relevance[document_id] += term_freq * inverse_document_freq;
                 }
             }
-            
+            if (budget_checkpoint.IsExhausted()) {
+                break;
+            }
         }
     }
 
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) != 0) {
-            
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+    TRACE_SPAN("merge");
+    std::pmr::vector<Document> matched_documents(resource);
+    matched_documents.reserve(document_to_relevance.size());
+    for (const auto [document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({document_id, relevance, GetDocumentRating(document_id)});
+    }
+    
+    return matched_documents;
+}
+
+template <typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::ScoreTermAtATimeDense(const QueryPlan& plan, const std::pmr::vector<int>& excluded_ids,
+                                                               DocumentPredicate document_predicate,
+                                                               std::pmr::memory_resource* resource) const {
+    std::pmr::vector<double> relevances(document_id_limit_, 0.0, resource);
+    // a document may be matched with zero relevance, so matches are marked apart from the sums
+    std::pmr::vector<uint64_t> matched((document_id_limit_ + 63) / 64, 0, resource);
+    {
+        STAGE_TIMER(SearchStage::SCORING);
+        TRACE_SPAN("term_at_a_time_dense");
+        // accepted postings are copied out of the tree in blocks the kernel scores at once
+        std::array<int, SCORING_BLOCK_SIZE> block_ids;
+        std::array<double, SCORING_BLOCK_SIZE> block_term_freqs;
+        BudgetCheckpoint budget_checkpoint;
+        for (const PlannedWord& planned_word : plan.plus_words) {
+            const auto& word_freqs = *term_id_to_postings_[planned_word.term_id];
+            TRACE_TERM_SPAN("posting", planned_word.word, static_cast<int64_t>(word_freqs.size()));
+            auto excluded = excluded_ids.begin();
+            size_t block_size = 0;
+            for (const auto [document_id, term_freq] : word_freqs) {
+                if (budget_checkpoint.Visit()) {
+                    break;
+                }
+                if (!IsExcluded(excluded, excluded_ids, document_id) && IsDocumentAccepted(document_predicate, document_id)) {
+                    block_ids[block_size] = document_id;
+                    block_term_freqs[block_size] = term_freq;
+                    matched[document_id / 64] |= uint64_t{1} << (document_id % 64);
+                    if (++block_size == SCORING_BLOCK_SIZE) {
+                        AccumulateScores(block_ids.data(), block_term_freqs.data(), block_size,
+                                         planned_word.inverse_document_freq, relevances.data());
+                        block_size = 0;
+                    }
+                }
+            }
+            AccumulateScores(block_ids.data(), block_term_freqs.data(), block_size,
+                             planned_word.inverse_document_freq, relevances.data());
+            if (budget_checkpoint.IsExhausted()) {
+                break;
             }
-            
         }
     }
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+    TRACE_SPAN("merge");
+    std::pmr::vector<Document> matched_documents(resource);
+    for (size_t i = 0; i < matched.size(); ++i) {
+        for (uint64_t word = matched[i]; word != 0; word &= word - 1) {
+            const int document_id = static_cast<int>(i * 64 + __builtin_ctzll(word));
+            matched_documents.push_back({document_id, relevances[document_id], GetDocumentRating(document_id)});
+        }
+    }
+    return matched_documents;
+}
+
+template <typename DocumentPredicate>
+std::pmr::vector<Document> SearchServer::ScoreDocumentAtATime(const QueryPlan& plan, const std::pmr::vector<int>& excluded_ids,
+                                                              DocumentPredicate document_predicate,
+                                                              std::pmr::memory_resource* resource) const {
+    struct PostingCursor {
+        Postings::const_iterator current;
+        Postings::const_iterator end;
+        double inverse_document_freq;
+    };
+    std::pmr::vector<PostingCursor> cursors(resource);
+    cursors.reserve(plan.plus_words.size());
+    for (const PlannedWord& planned_word : plan.plus_words) {
+        const auto& word_freqs = *term_id_to_postings_[planned_word.term_id];
+        TRACE_TERM_SPAN("posting", planned_word.word, static_cast<int64_t>(word_freqs.size()));
+        cursors.push_back({word_freqs.begin(), word_freqs.end(), planned_word.inverse_document_freq});
     }
     
+    STAGE_TIMER(SearchStage::SCORING);
+    TRACE_SPAN("document_at_a_time");
+    std::pmr::vector<Document> matched_documents(resource);
+    auto excluded = excluded_ids.begin();
+    // documents come in id order, so a stopped query has scored every document below the last id in full
+    BudgetCheckpoint budget_checkpoint;
+    while (!cursors.empty() && !budget_checkpoint.Visit()) {
+        int document_id = cursors.front().current->first;
+        for (const PostingCursor& cursor : cursors) {
+            document_id = std::min(document_id, cursor.current->first);
+        }
+        // relevance is summed in plan order, the same order term-at-a-time execution uses
+        double relevance = 0.0;
+        for (PostingCursor& cursor : cursors) {
+            if (cursor.current->first == document_id) {
+                relevance += cursor.current->second * cursor.inverse_document_freq;
+                ++cursor.current;
+            }
+        }
+        cursors.erase(std::remove_if(cursors.begin(), cursors.end(), [](const PostingCursor& cursor) {
+            return cursor.current == cursor.end;
+        }), cursors.end());
+        if (!IsExcluded(excluded, excluded_ids, document_id) && IsDocumentAccepted(document_predicate, document_id)) {
+            matched_documents.push_back({document_id, relevance, GetDocumentRating(document_id)});
+        }
+    }
     return matched_documents;
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy policy, const Query query, DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> prev_document_to_relevance(100);
-    std::for_each(std::execution::par,
-                  query.plus_words.begin(),
-                  query.plus_words.end(),
-                  [this, &prev_document_to_relevance, document_predicate] (const std::string_view word) {
-                        if (word_to_document_freqs_.count(word) != 0) {
-                            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                                const auto& document_data = documents_.at(document_id);
-                                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                                    prev_document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                                }
-                            }
-                        }
-                  });
-    
-    std::map<int, double> document_to_relevance = prev_document_to_relevance.BuildOrdinaryMap();
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) != 0) {
-            
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+std::pmr::vector<Document> SearchServer::FindAllDocumentsConjunctive(const Query& query, DocumentPredicate document_predicate,
+                                                                     std::pmr::memory_resource* resource) const {
+    struct WordPostings {
+        std::string_view word;
+        const Postings* postings;
+        double inverse_document_freq;
+    };
+    std::pmr::vector<WordPostings> word_postings(resource);
+    word_postings.reserve(query.plus_words.size());
+    for (const std::string_view word : query.plus_words) {
+        const auto found = word_to_document_freqs_.find(word);
+        if (found == word_to_document_freqs_.end() || found->second.empty()) {
+            return std::pmr::vector<Document>(resource);
+        }
+        word_postings.push_back({word, &found->second, ComputeWordInverseDocumentFreq(word)});
+    }
+    if (word_postings.empty()) {
+        return std::pmr::vector<Document>(resource);
+    }
+    // the shortest list bounds the result, so every following intersection only shrinks it
+    std::sort(word_postings.begin(), word_postings.end(), [](const WordPostings& lhs, const WordPostings& rhs) {
+        return lhs.postings->size() < rhs.postings->size();
+    });
+    
+    std::pmr::vector<Document> candidates(resource);
+    {
+        STAGE_TIMER(SearchStage::SCORING);
+        const WordPostings& shortest = word_postings.front();
+        TRACE_TERM_SPAN("posting", shortest.word, static_cast<int64_t>(shortest.postings->size()));
+        for (const auto [document_id, term_freq] : *shortest.postings) {
+            if (IsDocumentAccepted(document_predicate, document_id)) {
+                candidates.push_back({document_id, term_freq * shortest.inverse_document_freq, 0});
             }
-            
+        }
+        for (size_t i = 1; i < word_postings.size() && !candidates.empty(); ++i) {
+            TRACE_TERM_SPAN("posting", word_postings[i].word, static_cast<int64_t>(word_postings[i].postings->size()));
+            IntersectWithPostings(candidates, *word_postings[i].postings, word_postings[i].inverse_document_freq);
         }
     }
     
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+    {
+        STAGE_TIMER(SearchStage::MINUS_WORDS);
+        TRACE_SPAN("minus_words");
+        for (const std::string_view word : query.minus_words) {
+            const auto found = word_to_document_freqs_.find(word);
+            if (found != word_to_document_freqs_.end()) {
+                SubtractPostings(candidates, found->second);
+            }
+        }
     }
     
-    return matched_documents;
+    for (Document& document : candidates) {
+        document.rating = GetDocumentRating(document.id);
+    }
+    return candidates;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsByPlan(std::execution::parallel_policy policy, const QueryPlan& plan,
+                                                           DocumentPredicate document_predicate,
+                                                           std::pmr::memory_resource* resource) const {
+    if (!plan.parallel) {
+        return SelectTopDocuments(ExecuteQueryPlan(plan, document_predicate, resource));
+    }
+    RecordQueryPlan(plan);
+    const std::pmr::vector<int> excluded_ids = CollectExcludedDocuments(plan, resource);
+    
+    // the arena belongs to the calling thread, so the workers accumulate into the heap-backed concurrent map
+    ConcurrentMap<int, double> document_to_relevance(100);
+    const uint64_t trace_id = GetActiveTraceId();
+    {
+        STAGE_TIMER(SearchStage::SCORING);
+        std::for_each(std::execution::par,
+                      plan.plus_words.begin(),
+                      plan.plus_words.end(),
+                      [this, &document_to_relevance, &excluded_ids, document_predicate, trace_id] (const PlannedWord& planned_word) {
+                            TraceScope trace_scope(trace_id);
+                            const auto& word_freqs = *term_id_to_postings_[planned_word.term_id];
+                            TRACE_TERM_SPAN("posting", planned_word.word, static_cast<int64_t>(word_freqs.size()));
+                            const double inverse_document_freq = planned_word.inverse_document_freq;
+                            auto excluded = excluded_ids.begin();
+                            for (const auto [document_id, term_freq] : word_freqs) {
+                                if (!IsExcluded(excluded, excluded_ids, document_id)
+                                    && IsDocumentAccepted(document_predicate, document_id)) {
+                                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+                                }
+                            }
+                      });
+    }
+    
+    // every bucket holds the final relevances of its own documents, so each one gets a bounded heap
+    // of its own and only the heaps, not the candidates, are merged on the calling thread
+    STAGE_TIMER(SearchStage::TOP_K);
+    TRACE_SPAN("sort");
+    std::vector<TopDocuments> bucket_top_documents(document_to_relevance.GetBucketCount(),
+                                                   TopDocuments(MAX_RESULT_DOCUMENT_COUNT));
+    document_to_relevance.ForEachBucket(std::execution::par,
+                                        [this, &bucket_top_documents](size_t bucket_index, const std::map<int, double>& bucket) {
+                                            TopDocuments& top_documents = bucket_top_documents[bucket_index];
+                                            for (const auto [document_id, relevance] : bucket) {
+                                                top_documents.Push({document_id, relevance, GetDocumentRating(document_id)});
+                                            }
+                                        });
+    TopDocuments top_documents(MAX_RESULT_DOCUMENT_COUNT);
+    for (const TopDocuments& bucket_top : bucket_top_documents) {
+        top_documents.Merge(bucket_top);
+    }
+    return top_documents.Extract();
+}
+
+// Pages of page_size results of the query, each fetched with FindTopDocumentsAfter when first visited
+inline auto PaginateTopDocuments(const SearchServer& search_server, const std::string_view raw_query, size_t page_size,
+                                 DocumentStatus status = DocumentStatus::ACTUAL) {
+    return PaginateLazily<Document>([&search_server, query = std::string(raw_query), page_size, status]
+                                    (const std::vector<Document>* previous_page) {
+        const SearchCursor cursor = previous_page ? SearchCursor(previous_page->back()) : SearchCursor();
+        return search_server.FindTopDocumentsAfter(query, status, cursor, page_size);
+    });
 }
@@ -1,6 +1,12 @@
 #pragma once
 #include "search_server.h"
 #include "document.h"
+#include "request_queue.h"
+#include "request_scheduler.h"
+#include "remove_duplicates.h"
+#include "near_duplicates.h"
+#include "metrics.h"
+#include "trace.h"
 #include <algorithm>
 #include <cmath>
 #include <map>
@@ -12,6 +18,11 @@
 #include <iostream>
 #include <string_view>
 #include <execution>
+#include <thread>
+#include <chrono>
+#include <future>
+#include <optional>
+#include <sstream>
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
@@ -106,6 +117,21 @@ void RunTestImpl(const Function& test_function, const std::string& function_name
 
 // test framework. end.
 
+// ids of the documents in the order they were found
+std::vector<int> GetDocumentIds(const std::vector<Document>& documents) {
+    std::vector<int> result;
+    for (const Document& document : documents) {
+        result.push_back(document.id);
+    }
+    return result;
+}
+
+std::vector<int> GetSortedDocumentIds(const std::vector<Document>& documents) {
+    std::vector<int> result = GetDocumentIds(documents);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
 // -------- Начало модульных тестов поисковой системы ----------
 
 // Тест проверяет, что поисковая система исключает стоп-слова при добавлении документов
@@ -195,7 +221,88 @@ void TestMatchingDocumentsToSearchQuery() {
         ASSERT_EQUAL_HINT(result_par, expected_result, "Incorrect result of paralell matching of document to search query"s);
         ASSERT(status_par == DocumentStatus::IRRELEVANT);
     }
+    {
+        const auto [result_par, status_par] = server.MatchDocument(std::execution::par, "cat city -dog"s, doc_id);
+        const std::vector<std::string_view> expected_result = {"cat"sv, "city"sv};
+        ASSERT_EQUAL_HINT(result_par, expected_result, "Minus words absent from the index must be ignored in parallel"s);
+    }
+    
+}
+
+void TestRemovingDocument() {
+    SearchServer server("in the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(2, "dog in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "bird in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    
+    server.RemoveDocument(2);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    ASSERT_EQUAL_HINT(std::vector<int>(server.begin(), server.end()), std::vector<int>({1, 3}),
+                      "A removed document must not be iterated over"s);
+    ASSERT(server.FindTopDocuments("dog"s).empty());
+    
+    server.RemoveDocument(std::execution::par, 1);
+    ASSERT_EQUAL(server.GetDocumentCount(), 1);
+    ASSERT_EQUAL(std::vector<int>(server.begin(), server.end()), std::vector<int>({3}));
+}
+
+void TestMatchingAgainstLongDocuments() {
+    SearchServer server("and"s);
+    std::string long_text;
+    std::string long_query;
+    for (int i = 0; i < 1000; ++i) {
+        long_text += "w"s + std::to_string(i) + " "s;
+        long_query += (i % 3 == 0 ? "w"s + std::to_string(i * 2) : "q"s + std::to_string(i)) + " "s;
+    }
+    server.AddDocument(1, "first words and others"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, long_text, DocumentStatus::BANNED, {1});
+    
+    const auto [matched, status] = server.MatchDocument("w999 w0 w500 missing w500 first"s, 2);
+    const std::vector<std::string_view> expected = {"w0"sv, "w500"sv, "w999"sv};
+    ASSERT_EQUAL_HINT(matched, expected, "Words must be found at both ends and in the middle of a long document"s);
+    ASSERT(status == DocumentStatus::BANNED);
+    ASSERT(std::get<0>(server.MatchDocument("w999 -w1"s, 2)).empty());
+    
+    const auto [matched_seq, _] = server.MatchDocument(long_query, 2);
+    const auto [matched_par, __] = server.MatchDocument(std::execution::par, long_query, 2);
+    ASSERT_EQUAL_HINT(matched_seq.size(), 167u, "Every third query word below w1000 must match"s);
+    ASSERT_EQUAL_HINT(matched_par, matched_seq, "Parallel matching of long queries must agree with sequential one"s);
+    ASSERT(std::is_sorted(matched_par.begin(), matched_par.end()));
+    
+    server.RemoveDocument(2);
+    server.AddDocument(3, "w1 first"s, DocumentStatus::ACTUAL, {1});
+    const std::vector<std::string_view> expected_after_removal = {"first"sv, "w1"sv};
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument("w1 first w2"s, 3)), expected_after_removal);
+}
+
+void TestBatchMatchingOfDocuments() {
+    SearchServer server("and in the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "dog in the big city"s, DocumentStatus::BANNED, {2});
+    server.AddDocument(3, "big cat and small dog"s, DocumentStatus::IRRELEVANT, {3});
+    server.AddDocument(4, "parrot"s, DocumentStatus::ACTUAL, {4});
+    
+    const std::vector<int> document_ids = {4, 3, 1, 2, 3};
+    for (const std::string& query : {"cat big city -small"s, "dog dog cat new"s, "-parrot city"s}) {
+        const auto results = server.MatchDocuments(query, document_ids);
+        const auto results_par = server.MatchDocuments(std::execution::par, query, document_ids);
+        ASSERT_EQUAL(results.size(), document_ids.size());
+        ASSERT_EQUAL(results_par.size(), document_ids.size());
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto [expected_words, expected_status] = server.MatchDocument(query, document_ids[i]);
+            const auto& [words, status] = results[i];
+            const auto& [words_par, status_par] = results_par[i];
+            ASSERT_EQUAL_HINT(words, expected_words, "Batch matching must agree with MatchDocument"s);
+            ASSERT_EQUAL_HINT(words_par, expected_words, "Parallel batch matching must agree with MatchDocument"s);
+            ASSERT(status == expected_status && status_par == expected_status);
+        }
+    }
     
+    try {
+        server.MatchDocuments("cat"s, {1, 42});
+        ASSERT_HINT(false, "Unknown document id must be rejected"s);
+    } catch (const std::out_of_range&) {
+    }
 }
 
 void TestFoundDocumentsAreSortedByRelevanceInDescendingOrder() {
@@ -221,6 +328,102 @@ void TestFoundDocumentsAreSortedByRelevanceInDescendingOrder() {
     ASSERT_HINT(found_docs[1].relevance >= found_docs[2].relevance, "Search results are not sorted in descending order of relevance"s);
 }
 
+void TestTopDocumentsSelection() {
+    std::vector<Document> candidates;
+    for (int id = 0; id < 200; ++id) {
+        candidates.push_back({(id * 37) % 200, (id % 7) * 0.25, id % 3});
+    }
+    std::vector<Document> expected = candidates;
+    std::sort(expected.begin(), expected.end(), IsRankedHigher);
+    expected.resize(MAX_RESULT_DOCUMENT_COUNT);
+    TopDocuments left(MAX_RESULT_DOCUMENT_COUNT);
+    TopDocuments right(MAX_RESULT_DOCUMENT_COUNT);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        (i % 2 == 0 ? left : right).Push(candidates[i]);
+    }
+    left.Merge(right);
+    ASSERT_EQUAL_HINT(GetDocumentIds(left.Extract()), GetDocumentIds(expected), "Merged heaps must keep the top documents of the whole set"s);
+
+    // every document matching "even" has the same relevance, so rating and then id decide
+    SearchServer server(""s);
+    for (int id = 0; id < 40'000; ++id) {
+        server.AddDocument(id, id % 2 == 0 ? "common even"s : "common odd"s, DocumentStatus::ACTUAL, {id % 3});
+    }
+    ASSERT(server.ExplainQuery(std::execution::par, "common even"s).parallel);
+    const std::vector<int> expected_ids = {2, 8, 14, 20, 26};
+    ASSERT_EQUAL_HINT(GetDocumentIds(server.FindTopDocuments("common even"s)), expected_ids,
+                      "Ties on relevance and rating must be broken by id"s);
+    for (int run = 0; run < 3; ++run) {
+        ASSERT_EQUAL_HINT(GetDocumentIds(server.FindTopDocuments(std::execution::par, "common even"s)), expected_ids,
+                          "Parallel top-K must rank exactly like the sequential one"s);
+    }
+}
+
+void TestSearchAfterPagination() {
+    SearchServer server(""s);
+    for (int id = 0; id < 60; ++id) {
+        server.AddDocument(id, id % 4 == 0 ? "cat cat dog"s : (id % 4 == 1 ? "cat dog dog"s : "cat"s),
+                           id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, {id % 3});
+    }
+    const std::vector<Document> all = server.FindTopDocumentsAfter("cat dog"s, SearchCursor(), 1000);
+    ASSERT_EQUAL(all.size(), 48u);
+    ASSERT(std::is_sorted(all.begin(), all.end(), IsRankedHigherExact));
+    ASSERT_EQUAL_HINT(GetDocumentIds(server.FindTopDocumentsAfter("cat dog"s, SearchCursor(), MAX_RESULT_DOCUMENT_COUNT)),
+                      GetDocumentIds(server.FindTopDocuments("cat dog"s)), "The first page must be the regular top documents"s);
+
+    std::vector<Document> paged;
+    std::string token;
+    for (int page = 0; page < 20; ++page) {
+        const auto documents = server.FindTopDocumentsAfter("cat dog"s, SearchCursor::Parse(token), 7);
+        if (documents.empty()) {
+            break;
+        }
+        paged.insert(paged.end(), documents.begin(), documents.end());
+        token = SearchCursor(documents.back()).ToString();
+    }
+    ASSERT_EQUAL_HINT(GetDocumentIds(paged), GetDocumentIds(all), "Pages must continue exactly after their cursors"s);
+    ASSERT_EQUAL(SearchCursor::Parse(""s).IsStart(), true);
+    
+    // within EPSILON the rating ranks a over b and b over c, while the relevance ranks c over a; the
+    // cursor must still page through them once each
+    const std::vector<Document> chained = {Document(1, 0.0, 3), Document(2, 0.6e-6, 2), Document(3, 1.2e-6, 1)};
+    ASSERT(IsRankedHigher(chained[0], chained[1]) && IsRankedHigher(chained[1], chained[2])
+           && IsRankedHigher(chained[2], chained[0]));
+    std::vector<int> chained_pages;
+    for (SearchCursor cursor; chained_pages.size() <= chained.size();) {
+        PageTopDocuments page(1);
+        for (const Document& document : chained) {
+            if (cursor.Precedes(document)) {
+                page.Push(document);
+            }
+        }
+        const std::vector<Document> documents = page.Extract();
+        if (documents.empty()) {
+            break;
+        }
+        chained_pages.push_back(documents.front().id);
+        cursor = SearchCursor(documents.front());
+    }
+    ASSERT_EQUAL_HINT(chained_pages, (std::vector<int>{3, 2, 1}), "Cursor order must be a strict total order"s);
+    for (const std::string& token : {"zz:1:2"s, "3ff0000000000000:1"s, "3ff0000000000000:1:2x"s}) {
+        try {
+            SearchCursor::Parse(token);
+            ASSERT_HINT(false, "Malformed cursor must be rejected"s);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+
+    auto pages = PaginateTopDocuments(server, "cat dog"s, 10, DocumentStatus::BANNED);
+    ASSERT_EQUAL(pages.GetPage(1).size(), 2u);
+    ASSERT_EQUAL_HINT(pages.GetFetchedPageCount(), 2u, "Pages must be fetched only up to the requested one"s);
+    ASSERT(!pages.HasPage(2));
+    size_t banned_count = 0;
+    for (const auto& page : pages) {
+        banned_count += page.size();
+    }
+    ASSERT_EQUAL(banned_count, 12u);
+}
+
 void TestCorrectCalculationOfAverageDocumentRating() {
     const int doc_id_1 = 1;
     const std::string content_1 = "cat in the city"s;
@@ -339,6 +542,211 @@ void TestSearchingDocumentsWithSpecifiedStatus() {
     }
 }
 
+void TestStatusFilteringFollowsIndexChanges() {
+    SearchServer server(""s);
+    server.AddDocument(3, "white cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(100'000, "black cat"s, DocumentStatus::BANNED, {2});
+    server.AddDocument(64, "cat"s, DocumentStatus::BANNED, {3});
+    
+    ASSERT_EQUAL(GetSortedDocumentIds(server.FindTopDocuments("cat"s)), std::vector<int>{3});
+    ASSERT_EQUAL(GetSortedDocumentIds(server.FindTopDocuments("cat"s, DocumentStatus::BANNED)), (std::vector<int>{64, 100'000}));
+    ASSERT_EQUAL(GetSortedDocumentIds(server.FindTopDocuments(std::execution::par, "cat"s, DocumentStatus::BANNED)), (std::vector<int>{64, 100'000}));
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::REMOVED).empty());
+    
+    server.RemoveDocument(100'000);
+    ASSERT_EQUAL_HINT(GetSortedDocumentIds(server.FindTopDocuments("cat"s, DocumentStatus::BANNED)), std::vector<int>{64},
+                      "Removed documents must leave the status filter"s);
+    server.RemoveDocument(std::execution::par, 3);
+    ASSERT(server.FindTopDocuments("cat"s).empty());
+    server.AddDocument(3, "cat"s, DocumentStatus::REMOVED, {1});
+    ASSERT(server.FindTopDocuments("cat"s).empty());
+    ASSERT_EQUAL(GetSortedDocumentIds(server.FindTopDocuments("cat"s, DocumentStatus::REMOVED)), std::vector<int>{3});
+    server.RemoveDocuments({3, 64});
+    ASSERT(server.FindTopDocuments("cat"s, DocumentStatus::BANNED).empty());
+    ASSERT_EQUAL(server.GetDocumentCount(), 0);
+}
+
+void TestFilteringByDocumentFilter() {
+    SearchServer server("and"s);
+    for (int id = 0; id < 200; ++id) {
+        const std::string text = "cat "s + (id % 2 == 0 ? "white"s : "black"s) + (id % 5 == 0 ? " dog"s : ""s);
+        const DocumentStatus status = static_cast<DocumentStatus>(id % DOCUMENT_STATUS_COUNT);
+        server.AddDocument(id, text, status, {id % 21 - 10});
+    }
+    
+    const auto check = [&server](const std::string& query, const DocumentFilter& filter) {
+        const auto expected = server.FindTopDocuments(query, [&filter](int document_id, DocumentStatus status, int rating) {
+            return (filter.statuses.empty() || filter.statuses.count(status) > 0)
+                && rating >= filter.min_rating && rating <= filter.max_rating
+                && document_id >= filter.min_id && document_id <= filter.max_id;
+        });
+        const auto found = server.FindTopDocuments(query, filter);
+        const auto found_par = server.FindTopDocuments(std::execution::par, query, filter);
+        ASSERT_EQUAL(found.size(), expected.size());
+        ASSERT_EQUAL(found_par.size(), expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL_HINT(found[i].id, expected[i].id, "Filter must select the same documents as the equivalent predicate"s);
+            ASSERT_EQUAL(found_par[i].id, expected[i].id);
+            ASSERT(std::abs(found[i].relevance - expected[i].relevance) < EPSILON);
+        }
+        return found.size();
+    };
+    
+    DocumentFilter selective;
+    selective.min_rating = 8;
+    selective.statuses = {DocumentStatus::ACTUAL, DocumentStatus::BANNED};
+    ASSERT(check("cat white -dog"s, selective) > 0);
+    ASSERT(check("white black dog"s, selective) > 0);
+    
+    DocumentFilter broad;
+    broad.min_id = 10;
+    broad.max_id = 150;
+    ASSERT_EQUAL(check("cat"s, broad), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    ASSERT(check("dog -white"s, DocumentFilter{}) > 0);
+    
+    DocumentFilter empty_range;
+    empty_range.min_rating = 5;
+    empty_range.max_rating = 4;
+    ASSERT_EQUAL(check("cat"s, empty_range), 0u);
+    
+    server.RemoveDocument(18);
+    DocumentFilter single;
+    single.min_id = 18;
+    single.max_id = 18;
+    ASSERT_EQUAL_HINT(check("cat"s, single), 0u, "Removed documents must not pass the filter"s);
+    
+    DocumentFilter negative_range;
+    negative_range.min_id = -1;
+    negative_range.max_id = 1;
+    ASSERT_EQUAL_HINT(check("cat"s, negative_range), 2u, "A range starting below zero must keep the ids from zero"s);
+    negative_range.min_id = std::numeric_limits<int>::min();
+    negative_range.max_id = -1;
+    ASSERT_EQUAL(check("cat"s, negative_range), 0u);
+}
+
+void TestConjunctiveMatchMode() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat and fluffy tail"s, DocumentStatus::ACTUAL, {5});
+    server.AddDocument(2, "white dog"s, DocumentStatus::ACTUAL, {4});
+    server.AddDocument(3, "fluffy white cat"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "white cat with collar"s, DocumentStatus::BANNED, {2});
+    for (int id = 10; id < 200; ++id) {
+        server.AddDocument(id, (id % 3 == 0 ? "cat "s : "dog "s) + (id % 2 == 0 ? "white"s : "black"s), DocumentStatus::ACTUAL, {1});
+    }
+    
+    const auto all = server.FindTopDocuments("white cat fluffy"s, MatchMode::ALL);
+    ASSERT_EQUAL_HINT(GetDocumentIds(all), (std::vector<int>{3, 1}), "ALL mode must keep only documents with every plus word"s);
+    const auto any = server.FindTopDocuments("white cat fluffy"s);
+    for (const Document& document : all) {
+        const auto same = std::find_if(any.begin(), any.end(), [&document](const Document& other) {
+            return other.id == document.id;
+        });
+        ASSERT(same != any.end() && std::abs(same->relevance - document.relevance) < EPSILON);
+    }
+    
+    ASSERT_EQUAL(GetDocumentIds(server.FindTopDocuments("white cat -fluffy -collar"s, MatchMode::ALL)).size(),
+                 static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    for (const Document& document : server.FindTopDocuments("white cat -fluffy"s, MatchMode::ALL)) {
+        ASSERT(document.id != 1 && document.id != 3);
+        ASSERT(document.id < 10 || document.id % 6 == 0);
+    }
+    ASSERT_EQUAL(GetDocumentIds(server.FindTopDocuments("white cat collar"s, DocumentStatus::BANNED, MatchMode::ALL)), std::vector<int>{4});
+    ASSERT(server.FindTopDocuments("white cat unknown"s, MatchMode::ALL).empty());
+    ASSERT(server.FindTopDocuments("-white"s, MatchMode::ALL).empty());
+    const auto predicate_all = server.FindTopDocuments("cat fluffy"s, [](int document_id, DocumentStatus, int) {
+        return document_id != 3;
+    }, MatchMode::ALL);
+    ASSERT_EQUAL(GetDocumentIds(predicate_all), std::vector<int>{1});
+    
+    server.EnableQueryCache(1 << 20);
+    ASSERT_EQUAL(GetDocumentIds(server.FindTopDocuments("white cat fluffy"s, MatchMode::ALL)), (std::vector<int>{3, 1}));
+    ASSERT_EQUAL_HINT(server.FindTopDocuments("white cat fluffy"s).size(), any.size(), "Cached ALL results must not leak into ANY mode"s);
+}
+
+void TestQueryPlanner() {
+    SearchServer server(""s);
+    for (int id = 0; id < 100; ++id) {
+        server.AddDocument(id, "common "s + (id % 10 == 0 ? "rare"s : "other"s) + (id % 25 == 0 ? " scarce"s : ""s),
+                           DocumentStatus::ACTUAL, {id});
+    }
+    
+    const QueryPlan plan = server.ExplainQuery("common scarce other unknown -rare -missing"s);
+    ASSERT_EQUAL(plan.plus_words.size(), 3u);
+    ASSERT_EQUAL_HINT(plan.plus_words[0].word, "scarce"sv, "The most selective word must be evaluated first"s);
+    ASSERT_EQUAL(plan.plus_words[0].postings, 4u);
+    ASSERT_EQUAL(plan.plus_words[1].word, "other"sv);
+    ASSERT_EQUAL(plan.plus_words[2].word, "common"sv);
+    ASSERT_EQUAL(plan.scored_postings, 194u);
+    ASSERT_EQUAL(plan.minus_words.size(), 1u);
+    ASSERT_EQUAL(plan.excluded_postings, 10u);
+    ASSERT(!plan.parallel);
+    ASSERT(!server.ExplainQuery(std::execution::par, "common scarce"s).parallel);
+    std::ostringstream explanation;
+    explanation << plan;
+    ASSERT(explanation.str().find("-rare(10)"s) != std::string::npos);
+    
+    ResetMetrics();
+    const auto documents = server.FindTopDocuments("common scarce -rare"s);
+    ASSERT_EQUAL(documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    ASSERT_EQUAL_HINT(documents[0].id, 75, "Documents excluded by minus words must not be scored"s);
+    ASSERT_EQUAL(documents[1].id, 25);
+#ifndef SEARCH_SERVER_DISABLE_METRICS
+    const MetricsSnapshot metrics = GetMetrics();
+    const auto decisions = [&metrics](PlannerDecision decision) {
+        return metrics.planner_decisions[static_cast<size_t>(decision)];
+    };
+    ASSERT_EQUAL(decisions(PlannerDecision::TERM_AT_A_TIME) + decisions(PlannerDecision::DOCUMENT_AT_A_TIME), 1u);
+    ASSERT_EQUAL(decisions(PlannerDecision::SEQUENTIAL), 1u);
+    ASSERT_EQUAL(decisions(PlannerDecision::MINUS_WORDS_FIRST), 1u);
+#endif
+    ResetMetrics();
+}
+
+void TestPreparedQueries() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::BANNED, {5, -12, 2, 1});
+    
+    const std::string raw_query = "fluffy groomed cat -collar -collar"s;
+    const PreparedQuery query = server.Prepare(raw_query);
+    ASSERT_EQUAL(query.GetPlusWords(), (std::vector<std::string>{"cat"s, "fluffy"s, "groomed"s}));
+    ASSERT_EQUAL(query.GetMinusWords(), std::vector<std::string>{"collar"s});
+    
+    const auto check = [&]() {
+        ASSERT_EQUAL_HINT(GetDocumentIds(server.FindTopDocuments(query)), GetDocumentIds(server.FindTopDocuments(raw_query)),
+                          "Prepared query must find the same documents as the raw one"s);
+        ASSERT_EQUAL(GetDocumentIds(server.FindTopDocuments(std::execution::par, query)), GetDocumentIds(server.FindTopDocuments(raw_query)));
+        ASSERT_EQUAL(GetDocumentIds(server.FindTopDocuments(query, DocumentStatus::BANNED)), GetDocumentIds(server.FindTopDocuments(raw_query, DocumentStatus::BANNED)));
+        const auto predicate = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+        ASSERT_EQUAL(GetDocumentIds(server.FindTopDocuments(query, predicate)), GetDocumentIds(server.FindTopDocuments(raw_query, predicate)));
+        for (const int document_id : server) {
+            ASSERT_EQUAL(std::get<0>(server.MatchDocument(query, document_id)), std::get<0>(server.MatchDocument(raw_query, document_id)));
+        }
+    };
+    check();
+    
+    server.AddDocument(4, "groomed fluffy cat"s, DocumentStatus::ACTUAL, {1});
+    server.RemoveDocument(2);
+    check();
+    ASSERT_EQUAL_HINT(server.FindTopDocuments(query).front().id, 4, "Prepared query must see documents added after preparation"s);
+    
+    SearchServer other_server(""s);
+    other_server.AddDocument(7, "groomed cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL_HINT(other_server.FindTopDocuments(query).size(), 1u, "Query prepared by another server must be resolved again"s);
+    
+    // a server built where a destroyed one lived, with the same number of changes, is still another server
+    std::optional<SearchServer> reused_server;
+    reused_server.emplace(""s);
+    reused_server->AddDocument(1, "dog"s, DocumentStatus::ACTUAL, {1});
+    const PreparedQuery outliving_query = reused_server->Prepare("dog"s);
+    reused_server.emplace(""s);
+    reused_server->AddDocument(2, "white cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_HINT(reused_server->FindTopDocuments(outliving_query).empty(), "Query must not outlive its server's term ids"s);
+    ASSERT(reused_server->FindTopDocuments(std::execution::par, outliving_query).empty());
+    ASSERT(std::get<0>(reused_server->MatchDocument(outliving_query, 2)).empty());
+}
+
 void TestCorrectCalculationOfDocumentRelevance() {
     const int doc_id= 1;
     const std::string content = "cat in the city"s;
@@ -366,14 +774,703 @@ void TestCorrectCalculationOfDocumentRelevance() {
     ASSERT_HINT(abs(found_docs[2].relevance - expected_relevance_3) < EPSILON, "Incorrect result of document relevance calculation"s);
 }
 
+void TestQueryResultCache() {
+    SearchServer server("in the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(2, "white rabbit in the new york city"s, DocumentStatus::ACTUAL, {10, 20, 30});
+    server.EnableQueryCache(1 << 20);
+    
+    const auto uncached = server.FindTopDocuments("city cat"s);
+    const auto cached = server.FindTopDocuments("cat city cat"s);
+    ASSERT_EQUAL(cached.size(), uncached.size());
+    ASSERT_EQUAL(server.GetQueryCacheStats().hits, 1u);
+    ASSERT_EQUAL(server.GetQueryCacheStats().misses, 1u);
+    
+    server.FindTopDocuments("city cat"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL_HINT(server.GetQueryCacheStats().misses, 2u, "Status must be a part of the cache key"s);
+    
+    server.AddDocument(3, "grey cat"s, DocumentStatus::ACTUAL, {5});
+    const auto after_add = server.FindTopDocuments("city cat"s);
+    ASSERT_EQUAL_HINT(after_add.size(), 3u, "Cache must be invalidated by AddDocument"s);
+    
+    server.RemoveDocument(3);
+    ASSERT_EQUAL_HINT(server.FindTopDocuments("city cat"s).size(), 2u, "Cache must be invalidated by RemoveDocument"s);
+    ASSERT_EQUAL(server.GetQueryCacheStats().hits, 1u);
+}
+
+void TestAsyncQueriesWithDeadline() {
+    SearchServer server(""s);
+    for (int id = 0; id < 20'000; ++id) {
+        server.AddDocument(id, id % 2 == 0 ? "common even"s : "common odd"s, DocumentStatus::ACTUAL, {id % 7});
+    }
+    const std::vector<Document> expected = server.FindTopDocuments("common even"s);
+
+    const TopDocumentsResult complete = server.FindTopDocumentsAsync("common even"s, std::chrono::seconds(60)).get();
+    ASSERT(!complete.truncated);
+    ASSERT_EQUAL_HINT(GetDocumentIds(complete.documents), GetDocumentIds(expected), "A query within its deadline must return the full result"s);
+
+    server.EnableQueryCache(1 << 20);
+    const TopDocumentsResult late = server.FindTopDocumentsAsync("common even"s, DocumentStatus::ACTUAL,
+                                                                 std::chrono::steady_clock::now() - std::chrono::seconds(1)).get();
+    ASSERT_HINT(late.truncated, "A query past its deadline must stop scoring"s);
+    ASSERT_HINT(!late.documents.empty() && late.documents.size() <= static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT),
+                "A truncated query must return the best documents scored so far"s);
+    ASSERT_EQUAL_HINT(GetDocumentIds(server.FindTopDocuments("common even"s)), GetDocumentIds(expected), "Truncated results must not be cached"s);
+
+    CancellationToken cancellation;
+    cancellation.Cancel();
+    ASSERT(server.FindTopDocumentsAsync("common odd"s, std::chrono::seconds(60), cancellation).get().truncated);
+
+    std::vector<std::future<TopDocumentsResult>> results;
+    for (int i = 0; i < 8; ++i) {
+        results.push_back(server.FindTopDocumentsAsync(i % 2 == 0 ? "common even"s : "even"s, std::chrono::seconds(60)));
+    }
+    for (auto& result : results) {
+        ASSERT_EQUAL(result.get().documents.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    }
+}
+
+void TestRequestScheduler() {
+    SearchServer server(""s);
+    for (int id = 0; id < 30'000; ++id) {
+        server.AddDocument(id, "alpha beta gamma delta epsilon zeta eta theta "s + (id % 2 == 0 ? "even"s : "odd"s),
+                           DocumentStatus::ACTUAL, {id % 5});
+    }
+    const std::string heavy_query = "alpha beta gamma delta epsilon zeta eta theta"s;
+    const auto timeout = std::chrono::seconds(60);
+    
+    {
+        RequestSchedulerConfig config;
+        config.min_concurrency = config.max_concurrency = config.initial_concurrency = 1;
+        config.max_queue_length = 2;
+        config.latency_target = std::chrono::hours(1);
+        RequestScheduler scheduler(server, config);
+        const ScheduledResult warmup = scheduler.Submit("odd"s, RequestPriority::INTERACTIVE, timeout).get();
+        ASSERT(warmup.outcome == RequestOutcome::SERVED);
+        ASSERT_EQUAL(GetDocumentIds(warmup.documents), GetDocumentIds(server.FindTopDocuments("odd"s)));
+        
+        // the heavy request must be seen holding the only slot; one that finished unseen is sent again
+        uint64_t unseen_heavy_requests = 0;
+        auto running = scheduler.Submit(heavy_query, RequestPriority::BATCH, timeout);
+        while (scheduler.GetStats().running == 0) {
+            if (running.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                ++unseen_heavy_requests;
+                running = scheduler.Submit(heavy_query, RequestPriority::BATCH, timeout);
+            }
+            std::this_thread::yield();
+        }
+        auto queued_batch = scheduler.Submit(heavy_query, RequestPriority::BATCH, timeout);
+        ASSERT_HINT(scheduler.Submit("even"s, DocumentStatus::ACTUAL, RequestPriority::INTERACTIVE,
+                                     RequestScheduler::Clock::now()).get().outcome == RequestOutcome::REJECTED_DEADLINE,
+                    "A request that cannot leave the queue in time must be rejected on arrival"s);
+        auto shed_batch = scheduler.Submit(heavy_query, RequestPriority::BATCH, timeout);
+        auto interactive = scheduler.Submit("even"s, RequestPriority::INTERACTIVE, timeout);
+        ASSERT(scheduler.Submit("even"s, DocumentStatus::ACTUAL, RequestPriority::INTERACTIVE,
+                                RequestScheduler::Clock::now()).get().outcome == RequestOutcome::REJECTED_DEADLINE);
+        ASSERT_HINT(shed_batch.get().outcome == RequestOutcome::REJECTED_OVERLOAD,
+                    "A full queue must shed batch work for an interactive request"s);
+        ASSERT(scheduler.Submit("even"s, RequestPriority::BATCH, timeout).get().outcome == RequestOutcome::REJECTED_OVERLOAD);
+        
+        const ScheduledResult interactive_result = interactive.get();
+        const ScheduledResult batch_result = queued_batch.get();
+        ASSERT(interactive_result.outcome == RequestOutcome::SERVED && batch_result.outcome == RequestOutcome::SERVED);
+        ASSERT_HINT(interactive_result.queue_time < batch_result.queue_time,
+                    "Interactive requests must be dispatched before batch ones submitted earlier"s);
+        ASSERT(running.get().outcome == RequestOutcome::SERVED);
+        
+        const RequestSchedulerStats stats = scheduler.GetStats();
+        const size_t interactive_index = static_cast<size_t>(RequestPriority::INTERACTIVE);
+        const size_t batch_index = static_cast<size_t>(RequestPriority::BATCH);
+        ASSERT_EQUAL(stats.served[interactive_index], 2u);
+        ASSERT_EQUAL(stats.served[batch_index], 2u + unseen_heavy_requests);
+        ASSERT_EQUAL(stats.rejected_overload[batch_index], 2u);
+        ASSERT_EQUAL_HINT(stats.rejected_deadline[interactive_index], 2u, "A request rejected on arrival must not shed batch work"s);
+        ASSERT_EQUAL(stats.service_time.count, 4u + unseen_heavy_requests);
+        
+        try {
+            scheduler.Submit("even --odd"s, RequestPriority::INTERACTIVE, timeout).get();
+            ASSERT_HINT(false, "The error of the query must reach the caller"s);
+        } catch (const std::invalid_argument&) {
+        }
+        const RequestSchedulerStats failed_stats = scheduler.GetStats();
+        ASSERT_EQUAL(failed_stats.failed[interactive_index], 1u);
+        ASSERT_EQUAL_HINT(failed_stats.served[interactive_index], 2u, "Failed requests must not count as served"s);
+        ASSERT_EQUAL(failed_stats.service_time.count, stats.service_time.count);
+    }
+    
+    {
+        RequestSchedulerConfig config;
+        config.min_concurrency = 1;
+        config.max_concurrency = config.initial_concurrency = 4;
+        config.latency_target = std::chrono::nanoseconds(1);
+        RequestScheduler scheduler(server, config);
+        for (int i = 0; i < 8; ++i) {
+            scheduler.Submit("odd"s, RequestPriority::INTERACTIVE, timeout).get();
+        }
+        ASSERT_EQUAL_HINT(scheduler.GetStats().concurrency_limit, 2u, "Slow requests must shrink the concurrency limit"s);
+    }
+    {
+        RequestSchedulerConfig config;
+        config.min_concurrency = config.initial_concurrency = 1;
+        config.max_concurrency = 3;
+        config.latency_target = std::chrono::hours(1);
+        RequestScheduler scheduler(server, config);
+        for (int i = 0; i < 8; ++i) {
+            scheduler.Submit("odd"s, RequestPriority::INTERACTIVE, timeout).get();
+        }
+        ASSERT_EQUAL_HINT(scheduler.GetStats().concurrency_limit, 2u, "The limit must grow only while it is reached"s);
+    }
+    {
+        RequestSchedulerConfig config;
+        config.min_concurrency = 4;
+        config.max_concurrency = 2;
+        try {
+            RequestScheduler scheduler(server, config);
+            ASSERT_HINT(false, "Concurrency bounds with min above max must be rejected"s);
+        } catch (const std::invalid_argument&) {
+        }
+    }
+}
+
+void TestRequestQueueStatistics() {
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(3, "big cat fancy collar "s, DocumentStatus::ACTUAL, {1, 2, 8});
+    
+    {
+        RequestQueue request_queue(server);
+        for (int i = 0; i < 1439; ++i) {
+            request_queue.AddFindRequest("empty request"s);
+        }
+        request_queue.AddFindRequest("curly dog"s);
+        request_queue.AddFindRequest("big collar"s);
+        request_queue.AddFindRequest("sparrow"s);
+        ASSERT_EQUAL_HINT(request_queue.GetNoResultRequests(), 1438, "Only the last 1440 requests must be counted"s);
+        ASSERT_EQUAL(request_queue.GetTotalRequests(), 1442u);
+    }
+    
+    {
+        RequestQueue request_queue(server, 4096);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; ++t) {
+            workers.emplace_back([&request_queue]() {
+                for (int i = 0; i < 100; ++i) {
+                    request_queue.AddFindRequest(i % 2 == 0 ? "sparrow"s : "curly"s);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        const RequestStats stats = request_queue.GetStats(std::chrono::hours(1));
+        ASSERT_EQUAL(stats.requests, 400u);
+        ASSERT_EQUAL(stats.no_result_requests, 200u);
+        ASSERT_EQUAL(stats.result_count_distribution[0], 200u);
+        ASSERT_EQUAL(stats.result_count_distribution[2], 200u);
+        ASSERT(std::abs(stats.no_result_rate - 0.5) < EPSILON);
+        ASSERT(!stats.window_truncated);
+    }
+
+    {
+        // writers lapping each other on a small ring must not leave a slot half-written
+        RequestQueue request_queue(server, 3);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; ++t) {
+            workers.emplace_back([&request_queue, t]() {
+                for (int i = 0; i < 500; ++i) {
+                    request_queue.AddFindRequest(t % 2 == 0 ? "sparrow"s : "curly"s);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        const RequestStats stats = request_queue.GetStats(std::chrono::hours(1));
+        ASSERT(stats.requests > 0 && stats.requests <= 3u);
+        ASSERT_EQUAL(stats.result_count_distribution[0] + stats.result_count_distribution[2], stats.requests);
+        ASSERT_EQUAL(request_queue.GetTotalRequests(), 2000u);
+    }
+}
+
+void TestStageMetrics() {
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Record(value * 1000);
+    }
+    const HistogramSnapshot snapshot = histogram.GetSnapshot();
+    ASSERT_EQUAL(snapshot.count, 1000u);
+    ASSERT_EQUAL(snapshot.max_ns, 1000000u);
+    ASSERT_HINT(std::abs(static_cast<double>(snapshot.p50_ns) - 500000.0) / 500000.0 < 0.02, "Percentiles must be within the histogram precision"s);
+    ASSERT_HINT(std::abs(static_cast<double>(snapshot.p99_ns) - 990000.0) / 990000.0 < 0.02, "Percentiles must be within the histogram precision"s);
+    
+#ifndef SEARCH_SERVER_DISABLE_METRICS
+    SearchServer server("in the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    const MetricsSnapshot before = GetMetrics();
+    server.FindTopDocuments("cat -dog"s);
+    server.MatchDocument("cat"s, 1);
+    const MetricsSnapshot after = GetMetrics();
+    for (SearchStage stage : {SearchStage::PARSE_QUERY, SearchStage::SCORING, SearchStage::MINUS_WORDS,
+                              SearchStage::TOP_K, SearchStage::MATCH_DOCUMENT}) {
+        const size_t index = static_cast<size_t>(stage);
+        ASSERT_HINT(after.stages[index].count > before.stages[index].count, std::string(GetStageName(stage)) + " stage was not recorded"s);
+    }
+#endif
+}
+
+void TestQueryTracing() {
+    SearchServer server("in the"s);
+    server.AddDocument(1, "cat in the city"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    server.AddDocument(2, "white rabbit in the new york city"s, DocumentStatus::ACTUAL, {10, 20, 30});
+    ClearTrace();
+    
+    server.FindTopDocuments("cat city"s);
+    ASSERT_EQUAL_HINT(GetTraceEventCount(), 0u, "Nothing must be recorded while tracing is disabled"s);
+    
+    EnableTracing(1.0);
+    server.FindTopDocuments("cat city"s);
+    server.FindTopDocuments(std::execution::par, "rabbit -cat"s);
+    DisableTracing();
+    
+    std::ostringstream out;
+    WriteTrace(out);
+    const std::string trace = out.str();
+    ASSERT(trace.find("\"traceEvents\""s) != std::string::npos);
+#ifndef SEARCH_SERVER_DISABLE_TRACING
+    ASSERT(trace.find("\"name\":\"ParseQuery\""s) != std::string::npos);
+    ASSERT_HINT(trace.find("\"term\":\"city\",\"postings\":2"s) != std::string::npos, "Posting spans must carry the posting length"s);
+    ASSERT(trace.find("\"name\":\"FindTopDocuments(par)\""s) != std::string::npos);
+    ASSERT(trace.find("\"name\":\"sort\""s) != std::string::npos);
+#else
+    ASSERT_EQUAL_HINT(GetTraceEventCount(), 0u, "Spans must be compiled out"s);
+#endif
+    ClearTrace();
+}
+
+void TestQueryArena() {
+    // a fresh thread starts with an initial block, so the overflow of every arena is predictable
+    std::thread([] {
+        {
+            QueryArena arena;
+            ASSERT(arena.GetResource()->allocate(QUERY_ARENA_INITIAL_BLOCK_SIZE / 2) != nullptr);
+            ASSERT_EQUAL_HINT(arena.GetOverflowBytes(), 0u, "Allocations that fit the thread block must not touch the heap"s);
+            ASSERT(arena.GetResource()->allocate(QUERY_ARENA_INITIAL_BLOCK_SIZE) != nullptr);
+            ASSERT(arena.GetOverflowBytes() > 0);
+            
+            QueryArena nested_arena;
+            ASSERT(nested_arena.GetResource()->allocate(16) != nullptr);
+            ASSERT_HINT(nested_arena.GetOverflowBytes() > 0, "Nested arena must not share the block of the outer one"s);
+        }
+        {
+            QueryArena arena;
+            ASSERT(arena.GetResource()->allocate(QUERY_ARENA_INITIAL_BLOCK_SIZE * 3 / 2) != nullptr);
+            ASSERT_EQUAL_HINT(arena.GetOverflowBytes(), 0u, "The block must grow to what the previous query used"s);
+        }
+    }).join();
+    
+    SearchServer server("and in"s);
+    server.AddDocument(1, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    QueryArena outer_arena;
+    const auto documents = server.FindTopDocuments("fluffy cat"s);
+    ASSERT_EQUAL(documents.size(), 2u);
+    ASSERT_EQUAL(documents.front().id, 2);
+}
+
+void TestStringArena() {
+    StringArena arena;
+    std::vector<std::string> words;
+    std::vector<std::string_view> stored_words;
+    for (int i = 0; i < 20000; ++i) {
+        words.push_back("word"s + std::to_string(i));
+        stored_words.push_back(arena.Store(words.back()));
+    }
+    const std::string long_word(STRING_ARENA_CHUNK_SIZE * 2, 'x');
+    ASSERT_EQUAL_HINT(arena.Store(long_word), long_word, "A string longer than a chunk must be stored whole"s);
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_EQUAL_HINT(stored_words[i], words[i], "Stored strings must stay valid while the arena grows"s);
+    }
+    ASSERT(arena.GetMemoryUsage() >= STRING_ARENA_CHUNK_SIZE * 3);
+}
+
+void TestMemoryUsage() {
+    SearchServer server("and in"s);
+    const MemoryUsage empty = server.GetMemoryUsage();
+    ASSERT_EQUAL(empty.postings, 0u);
+    ASSERT_EQUAL(empty.query_cache, 0u);
+    ASSERT(empty.stop_words > 0);
+    
+    for (int id = 0; id < 100; ++id) {
+        server.AddDocument(id, "cat number "s + std::to_string(id) + " and dog"s, DocumentStatus::ACTUAL, {id});
+    }
+    const MemoryUsage filled = server.GetMemoryUsage();
+    ASSERT(filled.term_dictionary > empty.term_dictionary);
+    ASSERT(filled.postings > 0);
+    ASSERT(filled.forward_index > empty.forward_index);
+    ASSERT(filled.document_metadata > empty.document_metadata);
+    ASSERT_EQUAL(filled.GetTotal(), filled.term_dictionary + filled.postings + filled.forward_index
+                                    + filled.document_metadata + filled.stop_words + filled.query_cache);
+    if (filled.exact) {
+        ASSERT_HINT(filled.index_pool_reserved >= filled.postings, "Pools must reserve at least what the index holds"s);
+        ASSERT(filled.index_pool_peak >= filled.index_pool_reserved);
+    }
+    
+    for (int id = 0; id < 50; ++id) {
+        server.RemoveDocument(id);
+    }
+    const MemoryUsage halved = server.GetMemoryUsage();
+    ASSERT_HINT(halved.postings < filled.postings, "Removed postings must be released"s);
+    ASSERT(halved.forward_index < filled.forward_index);
+    
+    server.EnableQueryCache(1 << 20);
+    server.FindTopDocuments("cat"s);
+    ASSERT(server.GetMemoryUsage().query_cache > 0);
+    
+    // status bitmaps grow with the number of documents, not with the largest id
+    SearchServer sparse_server(""s);
+    sparse_server.AddDocument(2'000'000'000, "cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_HINT(sparse_server.GetMemoryUsage().document_metadata < (1u << 20), "A large id must not allocate a bitmap up to it"s);
+    DocumentFilter filter;
+    filter.min_id = 1'000'000'000;
+    ASSERT_EQUAL(sparse_server.FindTopDocuments("cat"s, filter).size(), 1u);
+}
+
+void TestMovingServer() {
+    const auto make_server = [](int first_id) {
+        SearchServer server("and"s);
+        server.AddDocument(first_id, "white cat and fashionable collar"s, DocumentStatus::ACTUAL, {8});
+        server.AddDocument(first_id + 1, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7});
+        return server;
+    };
+    std::vector<SearchServer> servers;
+    servers.push_back(make_server(0));
+    const PreparedQuery query = servers[0].Prepare("fluffy cat"s);
+    // growing the vector moves the servers, their index must keep working
+    for (int i = 1; i < 10; ++i) {
+        servers.push_back(make_server(i * 10));
+    }
+    SearchServer& server = servers[0];
+    ASSERT_EQUAL(server.GetDocumentCount(), 2);
+    ASSERT_EQUAL(server.FindTopDocuments("fluffy"s).front().id, 1);
+    ASSERT_EQUAL_HINT(GetDocumentIds(server.FindTopDocuments(query)), GetDocumentIds(server.FindTopDocuments("fluffy cat"s)),
+                      "A moved server must keep its prepared queries"s);
+    server.AddDocument(2, "fluffy dog"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_EQUAL(std::get<0>(server.MatchDocument("fluffy collar"s, 2)), std::vector<std::string_view>{"fluffy"sv});
+    ASSERT(server.GetMemoryUsage().postings > 0);
+    ASSERT_EQUAL(server.FindTopDocumentsAsync("collar"s, std::chrono::seconds(60)).get().documents.size(), 1u);
+    
+    SearchServer moved = std::move(servers.back());
+    ASSERT_EQUAL(moved.FindTopDocuments("collar"s).front().id, 90);
+}
+
+void TestWordFrequencies() {
+    SearchServer server("and in"s);
+    server.AddDocument(1, "white cat and fluffy cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "dog in collar"s, DocumentStatus::ACTUAL, {1});
+    
+    const WordFrequencies words = server.GetWordFrequencies(1);
+    ASSERT_EQUAL(words.size(), 3u);
+    const std::vector<std::string_view> expected_words = {"cat"sv, "fluffy"sv, "white"sv};
+    std::vector<std::string_view> actual_words;
+    for (const auto& [word, _] : words) {
+        actual_words.push_back(word);
+    }
+    ASSERT_EQUAL_HINT(actual_words, expected_words, "Words must come in ascending order"s);
+    ASSERT(std::abs(words.at("cat"sv) - 0.5) < EPSILON);
+    ASSERT_EQUAL(words.count("dog"sv), 0u);
+    ASSERT(words.find("and"sv) == words.end());
+    ASSERT_HINT(server.GetWordFrequencies(42).empty(), "Unknown documents must give an empty view"s);
+    
+    server.AddDocument(3, "grey cat"s, DocumentStatus::ACTUAL, {1});
+    ASSERT_HINT(words.begin() == server.GetWordFrequencies(1).begin(), "Views must stay valid while documents are added"s);
+    
+    const std::vector<WordFrequencies> batch = server.GetWordFrequencies(std::vector<int>{3, 1, 42, 2});
+    ASSERT_EQUAL(batch.size(), 4u);
+    ASSERT_EQUAL(batch[0].size(), 2u);
+    ASSERT(batch[1].begin() == words.begin());
+    ASSERT(batch[2].empty());
+    ASSERT(std::abs(batch[3].at("collar"sv) - 0.5) < EPSILON);
+}
+
+void TestDocumentTable() {
+    std::pmr::unsynchronized_pool_resource resource;
+    DocumentTable table(&resource, &resource);
+    for (int id : {10, 3, 7, 1000}) {
+        std::pmr::vector<WordFrequency> words({{"cat"sv, 1.0}}, &resource);
+        table.Add(id, id * 2, id == 7 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL, id % 5, std::pmr::vector<int>({id}, &resource), std::move(words));
+    }
+    ASSERT_EQUAL(table.GetSize(), 4u);
+    ASSERT_EQUAL(table.Find(5), DocumentTable::NO_SLOT);
+    const size_t slot = table.Find(7);
+    ASSERT_EQUAL(table.GetRating(slot), 14);
+    ASSERT(table.GetStatus(slot) == DocumentStatus::BANNED);
+    ASSERT_EQUAL(table.GetLength(slot), 2);
+    const WordFrequencies words = table.GetWordFrequencies(table.Find(1000));
+    
+    ASSERT(table.Remove(10));
+    ASSERT(!table.Remove(10));
+    ASSERT_HINT(table.Remove(3), "The second removal leaves more dead slots than live ones and compacts the table"s);
+    ASSERT_EQUAL(table.GetSize(), 2u);
+    ASSERT_EQUAL(table.GetRating(table.Find(7)), 14);
+    ASSERT_EQUAL(table.GetTermIds(table.Find(1000)).front(), 1000);
+    ASSERT_HINT(table.GetWordFrequencies(table.Find(1000)).begin() == words.begin(), "Compaction must not move the forward index"s);
+    
+    table.Add(10, 0, DocumentStatus::ACTUAL, 0, std::pmr::vector<int>(&resource), std::pmr::vector<WordFrequency>(&resource));
+    const std::vector<int> ids(table.begin(), table.end());
+    ASSERT_EQUAL_HINT(ids, std::vector<int>({7, 1000, 10}), "Iteration must keep the order of addition"s);
+    
+    SearchServer server("and"s);
+    for (int id = 0; id < 20; ++id) {
+        server.AddDocument(id * 3, "cat number "s + std::to_string(id), DocumentStatus::ACTUAL, {id});
+    }
+    for (int id = 0; id < 15; ++id) {
+        server.RemoveDocument(id * 3);
+    }
+    ASSERT_EQUAL(server.GetDocumentCount(), 5);
+    ASSERT_EQUAL(std::vector<int>(server.begin(), server.end()), std::vector<int>({45, 48, 51, 54, 57}));
+    const auto found = server.FindTopDocuments("number 18"s);
+    ASSERT_EQUAL(found.size(), 5u);
+    ASSERT_EQUAL(found[0].id, 54);
+    ASSERT_EQUAL(found[0].rating, 18);
+}
+
+void TestDocumentBitmap() {
+    DocumentBitmap bitmap;
+    ASSERT_EQUAL(bitmap.Count(), 0u);
+    ASSERT(!bitmap.Test(5));
+    const std::vector<int> sparse_ids = {7, 3, 70'000, 2'000'000'000, 65'535, 65'536};
+    for (const int id : sparse_ids) {
+        bitmap.Set(id);
+    }
+    bitmap.Set(7);
+    ASSERT_EQUAL(bitmap.GetDocumentIds(), (std::vector<int>{3, 7, 65'535, 65'536, 70'000, 2'000'000'000}));
+    ASSERT(bitmap.Test(2'000'000'000));
+    ASSERT(!bitmap.Test(2'000'000'001));
+    bitmap.Reset(65'535);
+    bitmap.Reset(12);
+    ASSERT_EQUAL(bitmap.Count(), 5u);
+    
+    // a block holding more ids than fit its array becomes a bitmap
+    DocumentBitmap dense;
+    for (int id = 0; id < 20'000; id += 2) {
+        dense.Set(id);
+    }
+    ASSERT_EQUAL(dense.Count(), 10'000u);
+    ASSERT(dense.Test(19'998));
+    ASSERT(!dense.Test(19'999));
+    dense.Reset(19'998);
+    ASSERT(!dense.Test(19'998));
+    
+    DocumentBitmap merged = bitmap;
+    merged |= dense;
+    ASSERT_EQUAL(merged.Count(), bitmap.Count() + dense.Count());
+    ASSERT(merged.Test(70'000));
+    ASSERT(merged.Test(6));
+    const std::vector<int> merged_ids = merged.GetDocumentIds();
+    ASSERT_HINT(std::is_sorted(merged_ids.begin(), merged_ids.end()), "Ids must be listed in ascending order"s);
+    
+    merged.KeepRange(7, 65'536);
+    ASSERT_EQUAL(merged.GetDocumentIds().front(), 7);
+    ASSERT_EQUAL(merged.GetDocumentIds().back(), 65'536);
+    ASSERT_EQUAL(merged.Count(), 2u + (19'996 - 8) / 2 + 1);
+    merged.KeepRange(100, 99);
+    ASSERT_EQUAL(merged.Count(), 0u);
+}
+
+void TestScoringKernels() {
+    std::vector<int> document_ids(SCORING_BLOCK_SIZE - 3);
+    std::vector<double> term_freqs(document_ids.size());
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        document_ids[i] = static_cast<int>((i * 37) % 1000);
+        term_freqs[i] = 1.0 / (i + 3);
+    }
+    std::vector<double> expected(1000, 0.25);
+    AccumulateScores(ScoringKernel::SCALAR, document_ids.data(), term_freqs.data(), document_ids.size(), 0.7, expected.data());
+    for (const ScoringKernel kernel : GetSupportedScoringKernels()) {
+        std::vector<double> relevances(1000, 0.25);
+        AccumulateScores(kernel, document_ids.data(), term_freqs.data(), document_ids.size(), 0.7, relevances.data());
+        ASSERT_HINT(relevances == expected, "Kernel "s + std::string(GetScoringKernelName(kernel)) + " must match the scalar one bit for bit"s);
+    }
+    
+    // queries with many words are accumulated term by term; the same corpus with sparse ids uses the map
+    SearchServer server(""s);
+    SearchServer sparse_server(""s);
+    // the dense accumulator would still be cheap for the same documents with one far id, but it would hold
+    // ten slots per document
+    SearchServer spread_server(""s);
+    std::string query = "cat"s;
+    for (int word = 0; word < 12; ++word) {
+        query += " w"s + std::to_string(word);
+    }
+    for (int id = 0; id < 2000; ++id) {
+        std::string text = "cat"s;
+        for (int word = 0; word < 12; ++word) {
+            if (id % (word + 2) == 0) {
+                text += " w"s + std::to_string(word);
+            }
+        }
+        server.AddDocument(id, text, DocumentStatus::ACTUAL, {id % 10});
+        sparse_server.AddDocument(id * 1000, text, DocumentStatus::ACTUAL, {id % 10});
+        spread_server.AddDocument(id == 0 ? 20'000 : id, text, DocumentStatus::ACTUAL, {id % 10});
+    }
+    const QueryPlan plan = server.ExplainQuery(query);
+    ASSERT(plan.strategy == QueryStrategy::TERM_AT_A_TIME);
+    ASSERT_HINT(plan.dense_accumulator, "Term-at-a-time over dense ids must use the dense accumulator"s);
+    ASSERT(!sparse_server.ExplainQuery(query).dense_accumulator);
+    ASSERT(spread_server.ExplainQuery(query).strategy == QueryStrategy::TERM_AT_A_TIME);
+    ASSERT_HINT(!spread_server.ExplainQuery(query).dense_accumulator, "Widely spread ids must not size the dense accumulator"s);
+    
+    const auto dense = server.FindTopDocuments(query);
+    const auto sparse = sparse_server.FindTopDocuments(query);
+    ASSERT_EQUAL(dense.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+    ASSERT_EQUAL(dense.size(), sparse.size());
+    for (size_t i = 0; i < dense.size(); ++i) {
+        ASSERT_EQUAL(dense[i].id * 1000, sparse[i].id);
+        ASSERT_EQUAL_HINT(dense[i].relevance, sparse[i].relevance, "Dense accumulation must sum exactly like the map"s);
+    }
+    // the document contains only "cat", a word of every document
+    const auto only_cat = server.FindTopDocuments(query, [](int document_id, DocumentStatus, int) {
+        return document_id == 1;
+    });
+    ASSERT_EQUAL_HINT(only_cat.size(), 1u, "Documents matched with zero relevance must be found"s);
+    ASSERT_EQUAL(only_cat[0].relevance, 0.0);
+}
+
+void TestRemoveDuplicates() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    
+    RemoveDuplicates(server);
+    const std::vector<int> remaining_ids(server.begin(), server.end());
+    const std::vector<int> expected_ids = {1, 2, 6, 8, 9};
+    ASSERT_EQUAL_HINT(remaining_ids, expected_ids, "Duplicates with bigger ids must be removed"s);
+    ASSERT_EQUAL(server.GetDocumentCount(), 5);
+    ASSERT_HINT(server.GetWordFrequencies(3).empty(), "Forward index of removed documents must be cleared"s);
+    ASSERT_EQUAL(server.FindTopDocuments("curly"s).size(), 2u);
+    
+    // the lowest id of a group is kept even when it was added after its duplicates
+    SearchServer late_server(""s);
+    late_server.AddDocument(20, "white cat"s, DocumentStatus::ACTUAL, {1});
+    late_server.AddDocument(30, "cat white cat"s, DocumentStatus::ACTUAL, {1});
+    late_server.AddDocument(10, "white white cat"s, DocumentStatus::ACTUAL, {1});
+    late_server.AddDocument(5, "black cat"s, DocumentStatus::ACTUAL, {1});
+    RemoveDuplicates(late_server);
+    ASSERT_EQUAL_HINT(std::set<int>(late_server.begin(), late_server.end()), (std::set<int>{5, 10}),
+                      "The duplicate with the lowest id must be kept"s);
+}
+
+void TestNearDuplicates() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "white cat fluffy tail expressive eyes long whiskers soft paws"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "white cat fluffy tail expressive eyes long whiskers soft ears"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "and with"s, DocumentStatus::ACTUAL, {1});
+
+    const double threshold = 0.7;
+    const auto pairs = FindNearDuplicates(server, threshold);
+    ASSERT_EQUAL_HINT(pairs.size(), 1u, "Only documents 1 and 2 are near duplicates"s);
+    ASSERT_EQUAL(pairs[0].first_id, 1);
+    ASSERT_EQUAL(pairs[0].second_id, 2);
+    ASSERT(std::abs(pairs[0].similarity - 9.0 / 11.0) < 1e-9);
+    ASSERT(std::abs(ComputeJaccardSimilarity(server.GetWordFrequencies(1), server.GetWordFrequencies(3)) - 2.0 / 12.0) < 1e-9);
+
+    NearDuplicateIndex index(threshold);
+    ASSERT(index.GetBandCount() * index.GetRowsPerBand() <= MINHASH_SIGNATURE_SIZE);
+    ASSERT(index.AddDocument(server, 1).empty());
+    ASSERT(index.AddDocument(server, 3).empty());
+    const auto incremental = index.AddDocument(server, 2);
+    ASSERT_EQUAL_HINT(incremental.size(), 1u, "Incremental insertion must report the similar document"s);
+    ASSERT_EQUAL(incremental[0].first_id, 1);
+    index.RemoveDocument(1);
+    ASSERT(index.FindAllPairs(server).empty());
+    
+    {
+        // with one row per band about half of the documents share the bucket of the common word in every band
+        SearchServer crowded_server(""s);
+        const size_t document_count = 4 * NEAR_DUPLICATE_BUCKET_WINDOW + 10;
+        for (size_t id = 0; id < document_count; ++id) {
+            crowded_server.AddDocument(static_cast<int>(id), "common word"s + std::to_string(id), DocumentStatus::ACTUAL, {1});
+        }
+        ASSERT_EQUAL(NearDuplicateIndex(0.05).GetRowsPerBand(), 1);
+        // each band compares a document with a window of the bucket only, but the windows differ from band
+        // to band, so together they still reach most pairs
+        const auto crowded_pairs = FindNearDuplicates(crowded_server, 0.05);
+        ASSERT_HINT(crowded_pairs.size() >= (document_count - NEAR_DUPLICATE_BUCKET_WINDOW) * NEAR_DUPLICATE_BUCKET_WINDOW,
+                    "Documents in the window must still be compared"s);
+        for (const NearDuplicatePair& pair : crowded_pairs) {
+            ASSERT(std::abs(pair.similarity - 1.0 / 3.0) < 1e-9);
+        }
+    }
+    {
+        // clusters larger than the window: exact duplicates share a signature, near ones fill a bucket
+        SearchServer cluster_server(""s);
+        NearDuplicateIndex cluster_index(0.9);
+        const int cluster_size = static_cast<int>(NEAR_DUPLICATE_BUCKET_WINDOW) + 36;
+        size_t incremental_pairs = 0;
+        for (int id = 0; id < cluster_size; ++id) {
+            cluster_server.AddDocument(id, "white cat fluffy tail expressive eyes long whiskers soft paws"s,
+                                       DocumentStatus::ACTUAL, {1});
+            incremental_pairs += cluster_index.AddDocument(cluster_server, id).size();
+        }
+        const size_t all_pairs = static_cast<size_t>(cluster_size) * (cluster_size - 1) / 2;
+        ASSERT_EQUAL_HINT(FindNearDuplicates(cluster_server, 0.9).size(), all_pairs, "Every pair of exact duplicates must be found"s);
+        ASSERT_EQUAL(incremental_pairs, all_pairs);
+        cluster_index.RemoveDocument(0);
+        ASSERT_EQUAL(cluster_index.FindAllPairs(cluster_server).size(), all_pairs - (cluster_size - 1));
+        
+        SearchServer near_server(""s);
+        for (int id = 0; id < cluster_size; ++id) {
+            near_server.AddDocument(id, "white cat fluffy tail expressive eyes long whiskers soft paws tag"s + std::to_string(id),
+                                    DocumentStatus::ACTUAL, {1});
+        }
+        ASSERT_EQUAL_HINT(FindNearDuplicates(near_server, 0.5).size(), all_pairs,
+                          "Bands must pair a cluster larger than the window in different orders"s);
+    }
+}
+
 void TestSearchServer() {
     RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
     RUN_TEST(TestAddingDocument);
     RUN_TEST(TestExcludeDocumentsContainingMinusWords);
     RUN_TEST(TestMatchingDocumentsToSearchQuery);
+    RUN_TEST(TestRemovingDocument);
+    RUN_TEST(TestMatchingAgainstLongDocuments);
+    RUN_TEST(TestBatchMatchingOfDocuments);
     RUN_TEST(TestFoundDocumentsAreSortedByRelevanceInDescendingOrder);
+    RUN_TEST(TestTopDocumentsSelection);
+    RUN_TEST(TestSearchAfterPagination);
     RUN_TEST(TestCorrectCalculationOfAverageDocumentRating);
     RUN_TEST(TestFilteringSearchResultsByUserPredicat);
     RUN_TEST(TestSearchingDocumentsWithSpecifiedStatus);
+    RUN_TEST(TestStatusFilteringFollowsIndexChanges);
+    RUN_TEST(TestFilteringByDocumentFilter);
+    RUN_TEST(TestConjunctiveMatchMode);
+    RUN_TEST(TestQueryPlanner);
+    RUN_TEST(TestScoringKernels);
+    RUN_TEST(TestPreparedQueries);
     RUN_TEST(TestCorrectCalculationOfDocumentRelevance);
+    RUN_TEST(TestQueryResultCache);
+    RUN_TEST(TestAsyncQueriesWithDeadline);
+    RUN_TEST(TestRequestScheduler);
+    RUN_TEST(TestRequestQueueStatistics);
+    RUN_TEST(TestStageMetrics);
+    RUN_TEST(TestQueryTracing);
+    RUN_TEST(TestQueryArena);
+    RUN_TEST(TestStringArena);
+    RUN_TEST(TestMemoryUsage);
+    RUN_TEST(TestMovingServer);
+    RUN_TEST(TestWordFrequencies);
+    RUN_TEST(TestDocumentTable);
+    RUN_TEST(TestDocumentBitmap);
+    RUN_TEST(TestRemoveDuplicates);
+    RUN_TEST(TestNearDuplicates);
 }
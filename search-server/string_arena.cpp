@@ -0,0 +1,21 @@
+#include <algorithm>
+#include <cstring>
+#include "string_arena.h"
+
+std::string_view StringArena::Store(std::string_view text) {
+    if (chunks_.empty() || chunk_size_ - chunk_used_ < text.size()) {
+        // a string longer than a chunk gets a chunk of its own
+        chunk_size_ = std::max(STRING_ARENA_CHUNK_SIZE, text.size());
+        chunks_.push_back(std::make_unique<char[]>(chunk_size_));
+        chunk_used_ = 0;
+        memory_usage_ += chunk_size_;
+    }
+    char* const data = chunks_.back().get() + chunk_used_;
+    std::memcpy(data, text.data(), text.size());
+    chunk_used_ += text.size();
+    return {data, text.size()};
+}
+
+size_t StringArena::GetMemoryUsage() const {
+    return memory_usage_ + chunks_.capacity() * sizeof(chunks_.front());
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+const size_t STRING_ARENA_CHUNK_SIZE = 64 * 1024;
+
+// Append-only storage for strings living as long as the arena. Strings are packed one after another
+// into large chunks that are never moved or freed, so the returned views stay valid and a million
+// short terms cost a few dozen allocations instead of a million.
+class StringArena {
+public:
+    std::string_view Store(std::string_view text);
+    size_t GetMemoryUsage() const;
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_used_ = 0;
+    size_t chunk_size_ = 0;
+    size_t memory_usage_ = 0;
+};
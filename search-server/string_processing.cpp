@@ -23,15 +23,24 @@ std::vector<std::string> SplitIntoWords(const std::string& text) {
     return words;
 }
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view str) {
-    std::vector<std::string_view> result;
+template <typename Container>
+void AppendWords(std::string_view str, Container& words) {
     str.remove_prefix(std::min(str.size(), str.find_first_not_of(" ")));
     while (!str.empty()) {
         int64_t space = str.find(' ');
         if (str[0] != ' ') {
-            result.push_back(str.substr(0, space));
+            words.push_back(str.substr(0, space));
         }
         str.remove_prefix(std::min(str.size(), space == -1 ? str.npos : static_cast<size_t>(space) + 1));
     }
+}
+
+std::vector<std::string_view> SplitIntoWordsView(std::string_view str) {
+    std::vector<std::string_view> result;
+    AppendWords(str, result);
     return result;
 }
+
+void SplitIntoWordsView(std::string_view str, std::pmr::vector<std::string_view>& words) {
+    AppendWords(str, words);
+}
@@ -2,14 +2,18 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <functional>
+#include <memory_resource>
 #include <string_view>
 
 std::vector<std::string> SplitIntoWords(const std::string& text);
 std::vector<std::string_view> SplitIntoWordsView(std::string_view str);
+// Appends the words to the given vector, so that callers choose where the memory comes from
+void SplitIntoWordsView(std::string_view str, std::pmr::vector<std::string_view>& words);
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
     for (const std::string_view str : strings) {
         if (!str.empty()) {
             non_empty_strings.insert(std::string(str));
@@ -2,6 +2,7 @@
 #include <vector>
 #include <stdexcept>
 #include <iostream>
+#include <execution>
 #include "test_example_functions.h"
 #include "document.h"
 #include "search_server.h"
@@ -34,9 +35,11 @@ void MatchDocuments(const SearchServer& search_server, const std::string& query)
     LOG_DURATION_STREAM("Operation time", std::cout);
     try {
         std::cout << "Матчинг документов по запросу: "s << query << std::endl;
-        for (const int document_id : search_server) {
-            const auto [words, status] = search_server.MatchDocument(query, document_id);
-            PrintMatchDocumentResult(document_id, words, status);
+        const std::vector<int> document_ids(search_server.begin(), search_server.end());
+        const auto results = search_server.MatchDocuments(std::execution::par, query, document_ids);
+        for (size_t i = 0; i < document_ids.size(); ++i) {
+            const auto& [words, status] = results[i];
+            PrintMatchDocumentResult(document_ids[i], words, status);
         }
     } catch (const std::invalid_argument& e) {
         std::cout << "Ошибка матчинга документов на запрос "s << query << ": "s << e.what() << std::endl;
@@ -0,0 +1,76 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "document.h"
+
+// relevances closer than this are considered equal and the rating decides
+const double EPSILON = 1e-6;
+
+// Ranking order of search results: higher relevance first, then higher rating, then lower id,
+// so documents that tie on relevance and rating come out in the same order on every run
+inline bool IsRankedHigher(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= EPSILON) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+// The same order with relevances compared exactly. IsRankedHigher is not transitive, as relevances
+// within EPSILON chain into ones that are not, while this is a strict total order, so a search-after
+// cursor splits the results into the documents before and after it
+inline bool IsRankedHigherExact(const Document& lhs, const Document& rhs) {
+    return std::tie(lhs.relevance, lhs.rating, rhs.id) > std::tie(rhs.relevance, rhs.rating, lhs.id);
+}
+
+// Keeps the best documents pushed into it, at most capacity of them, in a heap whose top is the worst
+// kept document, so a candidate that cannot make the result costs one comparison. Heaps built over
+// disjoint parts of the candidates are merged into the top documents of the whole set.
+template <bool (*IsHigher)(const Document&, const Document&)>
+class BasicTopDocuments {
+public:
+    explicit BasicTopDocuments(size_t capacity)
+        : capacity_(capacity) {
+        documents_.reserve(capacity);
+    }
+
+    void Push(const Document& document) {
+        if (documents_.size() < capacity_) {
+            documents_.push_back(document);
+            std::push_heap(documents_.begin(), documents_.end(), IsHigher);
+        } else if (capacity_ > 0 && IsHigher(document, documents_.front())) {
+            std::pop_heap(documents_.begin(), documents_.end(), IsHigher);
+            documents_.back() = document;
+            std::push_heap(documents_.begin(), documents_.end(), IsHigher);
+        }
+    }
+    void Merge(const BasicTopDocuments& other) {
+        for (const Document& document : other.documents_) {
+            Push(document);
+        }
+    }
+
+    size_t GetSize() const {
+        return documents_.size();
+    }
+    // The kept documents in ranking order; the heap is left empty
+    std::vector<Document> Extract() {
+        std::sort_heap(documents_.begin(), documents_.end(), IsHigher);
+        return std::move(documents_);
+    }
+
+private:
+    size_t capacity_;
+    std::vector<Document> documents_;
+};
+
+// top documents of search results
+using TopDocuments = BasicTopDocuments<IsRankedHigher>;
+// top documents of a search-after page, in the order of SearchCursor
+using PageTopDocuments = BasicTopDocuments<IsRankedHigherExact>;
@@ -0,0 +1,213 @@
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "trace.h"
+
+using namespace std::string_literals;
+
+namespace {
+
+const size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+struct TraceEvent {
+    const char* name;
+    int64_t start_ns;
+    int64_t duration_ns;
+    uint64_t trace_id;
+    std::string term;
+    int64_t postings;
+};
+
+struct ThreadTraceBuffer {
+    uint32_t thread_index;
+    std::mutex m;
+    std::vector<TraceEvent> events;
+    uint64_t dropped_events = 0;
+};
+
+struct TraceRegistry {
+    std::mutex m;
+    std::vector<std::shared_ptr<ThreadTraceBuffer>> buffers;
+    const TraceSpan::Clock::time_point start_time = TraceSpan::Clock::now();
+};
+
+std::atomic<bool> tracing_enabled{false};
+std::atomic<uint64_t> sample_period{1};
+std::atomic<uint64_t> next_trace_id{1};
+thread_local uint64_t active_trace_id = 0;
+thread_local uint64_t queries_since_sample = 0;
+
+TraceRegistry& GetRegistry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+ThreadTraceBuffer& GetThreadBuffer() {
+    thread_local std::shared_ptr<ThreadTraceBuffer> buffer = [] {
+        auto created = std::make_shared<ThreadTraceBuffer>();
+        TraceRegistry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.m);
+        created->thread_index = static_cast<uint32_t>(registry.buffers.size() + 1);
+        registry.buffers.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+void WriteJsonString(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+}  // namespace
+
+void EnableTracing(double sample_rate) {
+    if (!(sample_rate > 0.0 && sample_rate <= 1.0)) {
+        throw std::invalid_argument("trace sample rate must be in (0, 1]"s);
+    }
+    GetRegistry();
+    sample_period.store(static_cast<uint64_t>(std::llround(1.0 / sample_rate)), std::memory_order_relaxed);
+    tracing_enabled.store(true, std::memory_order_relaxed);
+}
+
+void DisableTracing() {
+    tracing_enabled.store(false, std::memory_order_relaxed);
+}
+
+bool IsTracingEnabled() {
+    return tracing_enabled.load(std::memory_order_relaxed);
+}
+
+void WriteTrace(std::ostream& out) {
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> registry_lock(registry.m);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard<std::mutex> lock(buffer->m);
+        for (const TraceEvent& event : buffer->events) {
+            if (!first) {
+                out << ',';
+            }
+            first = false;
+            out << "\n{\"name\":";
+            WriteJsonString(out, event.name);
+            out << ",\"cat\":\"search\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_index
+                << ",\"ts\":" << event.start_ns / 1000 << '.' << event.start_ns % 1000 / 100
+                << ",\"dur\":" << event.duration_ns / 1000 << '.' << event.duration_ns % 1000 / 100
+                << ",\"args\":{\"query\":" << event.trace_id;
+            if (!event.term.empty()) {
+                out << ",\"term\":";
+                WriteJsonString(out, event.term);
+            }
+            if (event.postings >= 0) {
+                out << ",\"postings\":" << event.postings;
+            }
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+void WriteTraceFile(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("can not open trace file "s + path);
+    }
+    WriteTrace(out);
+}
+
+void ClearTrace() {
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> registry_lock(registry.m);
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard<std::mutex> lock(buffer->m);
+        buffer->events.clear();
+        buffer->dropped_events = 0;
+    }
+}
+
+size_t GetTraceEventCount() {
+    TraceRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> registry_lock(registry.m);
+    size_t count = 0;
+    for (const auto& buffer : registry.buffers) {
+        std::lock_guard<std::mutex> lock(buffer->m);
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+uint64_t GetActiveTraceId() {
+    return active_trace_id;
+}
+
+TraceScope::TraceScope()
+    : previous_trace_id_(active_trace_id) {
+    if (previous_trace_id_ != 0 || !tracing_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (++queries_since_sample >= sample_period.load(std::memory_order_relaxed)) {
+        queries_since_sample = 0;
+        active_trace_id = next_trace_id.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+TraceScope::TraceScope(uint64_t trace_id)
+    : previous_trace_id_(active_trace_id) {
+    active_trace_id = trace_id;
+}
+
+TraceScope::~TraceScope() {
+    active_trace_id = previous_trace_id_;
+}
+
+TraceSpan::TraceSpan(const char* name)
+    : name_(name)
+    , trace_id_(active_trace_id) {
+    if (trace_id_ != 0) {
+        start_time_ = Clock::now();
+    }
+}
+
+TraceSpan::TraceSpan(const char* name, std::string_view term, int64_t postings)
+    : name_(name)
+    , trace_id_(active_trace_id) {
+    if (trace_id_ != 0) {
+        term_ = std::string(term);
+        postings_ = postings;
+        start_time_ = Clock::now();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (trace_id_ == 0) {
+        return;
+    }
+    const auto end_time = Clock::now();
+    const auto origin = GetRegistry().start_time;
+    ThreadTraceBuffer& buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.m);
+    if (buffer.events.size() >= MAX_EVENTS_PER_THREAD) {
+        ++buffer.dropped_events;
+        return;
+    }
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+    buffer.events.push_back({name_,
+                             duration_cast<nanoseconds>(start_time_ - origin).count(),
+                             duration_cast<nanoseconds>(end_time - start_time_).count(),
+                             trace_id_,
+                             std::move(term_),
+                             postings_});
+}
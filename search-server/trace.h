@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Sampled per-query tracing in Chrome trace_event format (opens in chrome://tracing and Perfetto).
+// While tracing is disabled a span costs one thread_local load; -DSEARCH_SERVER_DISABLE_TRACING removes spans entirely.
+#define TRACE_CONCAT_INTERNAL(X, Y) X##Y
+#define TRACE_CONCAT(X, Y) TRACE_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_DISABLE_TRACING
+#define TRACE_QUERY(name)
+#define TRACE_SPAN(name)
+#define TRACE_TERM_SPAN(name, term, postings)
+#else
+#define TRACE_QUERY(name) TraceScope TRACE_CONCAT(traceScope, __LINE__); TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_TERM_SPAN(name, term, postings) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, term, postings)
+#endif
+
+// sample_rate is the share of queries to trace: 1.0 traces every query, 0.01 every hundredth one
+void EnableTracing(double sample_rate);
+void DisableTracing();
+bool IsTracingEnabled();
+
+void WriteTrace(std::ostream& out);
+void WriteTraceFile(const std::string& path);
+void ClearTrace();
+size_t GetTraceEventCount();
+
+uint64_t GetActiveTraceId();
+
+// Marks the current thread as working on a traced query. The default constructor samples a new query
+// unless one is already active; the explicit one carries the decision of the caller into worker threads.
+class TraceScope {
+public:
+    TraceScope();
+    explicit TraceScope(uint64_t trace_id);
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+    ~TraceScope();
+
+private:
+    uint64_t previous_trace_id_;
+};
+
+class TraceSpan {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TraceSpan(const char* name);
+    TraceSpan(const char* name, std::string_view term, int64_t postings);
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    ~TraceSpan();
+
+private:
+    const char* name_;
+    uint64_t trace_id_;
+    Clock::time_point start_time_;
+    std::string term_;
+    int64_t postings_ = -1;
+};
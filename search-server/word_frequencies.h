@@ -0,0 +1,62 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+// a word of a document and its term frequency; the word points into the server's dictionary
+using WordFrequency = std::pair<std::string_view, double>;
+
+// Read-only view of the forward index of one document: its words in ascending order with their term
+// frequencies, stored contiguously, so iterating it is a linear scan and lookups are binary searches.
+// The view stays valid until the document is removed from the server.
+class WordFrequencies {
+public:
+    using value_type = WordFrequency;
+    using const_iterator = const WordFrequency*;
+    using iterator = const_iterator;
+
+    WordFrequencies() = default;
+    WordFrequencies(const WordFrequency* data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    const_iterator begin() const {
+        return data_;
+    }
+    const_iterator end() const {
+        return data_ + size_;
+    }
+    size_t size() const {
+        return size_;
+    }
+    bool empty() const {
+        return size_ == 0;
+    }
+    const WordFrequency& operator[](size_t index) const {
+        return data_[index];
+    }
+
+    const_iterator find(std::string_view word) const {
+        const const_iterator found = std::lower_bound(begin(), end(), word, [](const WordFrequency& entry, std::string_view value) {
+            return entry.first < value;
+        });
+        return found != end() && found->first == word ? found : end();
+    }
+    size_t count(std::string_view word) const {
+        return find(word) != end() ? 1 : 0;
+    }
+    double at(std::string_view word) const {
+        const const_iterator found = find(word);
+        if (found == end()) {
+            throw std::out_of_range("word is not in the document");
+        }
+        return found->second;
+    }
+
+private:
+    const WordFrequency* data_ = nullptr;
+    size_t size_ = 0;
+};